@@ -1,14 +1,9 @@
 #include "Dragon.h"
 #include <iostream>
 
-Dragon::Dragon(int x, int y, const std::string& name) : NPC(DragonType, x, y, name) {}
+Dragon::Dragon(int x, int y, std::string_view name) : NPC(DragonType, x, y, name) {}
 Dragon::Dragon(std::istream &is) : NPC(DragonType, is) {}
 
-bool Dragon::can_defeat(NpcType defender_type) const
-{
-    return true;
-}
-
 void Dragon::print()
 {
     std::cout << *this << std::endl;
@@ -16,7 +11,7 @@ void Dragon::print()
 
 void Dragon::save(std::ostream &os) 
 {
-    os << DragonType << std::endl;
+    os << DragonType << '\n';
     NPC::save(os);
 }
 
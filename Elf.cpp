@@ -1,14 +1,9 @@
 #include "Elf.h"
 #include <iostream>
 
-Elf::Elf(int x, int y, const std::string& name) : NPC(ElfType, x, y, name) {}
+Elf::Elf(int x, int y, std::string_view name) : NPC(ElfType, x, y, name) {}
 Elf::Elf(std::istream &is) : NPC(ElfType, is) {}
 
-bool Elf::can_defeat(NpcType defender_type) const
-{
-    return defender_type == KnightType;
-}
-
 void Elf::print()
 {
     std::cout << *this << std::endl;
@@ -16,7 +11,7 @@ void Elf::print()
 
 void Elf::save(std::ostream &os) 
 {
-    os << ElfType << std::endl;
+    os << ElfType << '\n';
     NPC::save(os);
 }
 
@@ -4,7 +4,7 @@
 class Elf : public NPC
 {
 public:
-    Elf(int x, int y, const std::string& name = "");
+    Elf(int x, int y, std::string_view name = "");
     Elf(std::istream &is);
     
     void print() override;
@@ -12,7 +12,4 @@ public:
     std::string get_type_str() const override;
     
     friend std::ostream &operator<<(std::ostream &os, Elf &elf);
-
-protected:
-    bool can_defeat(NpcType defender_type) const override;
 };
\ No newline at end of file
@@ -1,14 +1,9 @@
 #include "StrangeKnight.h"
 #include <iostream>
 
-Knight::Knight(int x, int y, const std::string& name) : NPC(KnightType, x, y, name) {}
+Knight::Knight(int x, int y, std::string_view name) : NPC(KnightType, x, y, name) {}
 Knight::Knight(std::istream &is) : NPC(KnightType, is) {}
 
-bool Knight::can_defeat(NpcType defender_type) const
-{
-    return defender_type == DragonType;
-}
-
 void Knight::print()
 {
     std::cout << *this << std::endl;
@@ -16,7 +11,7 @@ void Knight::print()
 
 void Knight::save(std::ostream &os) 
 {
-    os << KnightType << std::endl;
+    os << KnightType << '\n';
     NPC::save(os);
 }
 
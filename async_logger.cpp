@@ -0,0 +1,215 @@
+#include "async_logger.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+    std::atomic<uint64_t> next_logger_id{1};
+
+    // Rings this thread has claimed, per logger. On thread exit the rings
+    // are released so the next thread can reuse them; the lease keeps a
+    // reference so that is safe even after the logger is gone.
+    struct RingLease
+    {
+        struct Entry
+        {
+            uint64_t logger_id;
+            std::shared_ptr<void> ring;
+            std::atomic<bool> *owned;
+        };
+        std::vector<Entry> entries;
+
+        ~RingLease()
+        {
+            for (auto &entry : entries)
+                entry.owned->store(false);
+        }
+    };
+
+    thread_local RingLease lease;
+
+    template <size_t N>
+    void copy_field(char (&dst)[N], std::string_view src)
+    {
+        const size_t length = std::min(src.size(), N - 1);
+        std::memcpy(dst, src.data(), length);
+        dst[length] = '\0';
+    }
+
+    void append_name(std::string &out, uint32_t ref)
+    {
+        if (ref & NPC::auto_name)
+        {
+            out += "NPC_";
+            out += std::to_string(ref & ~NPC::auto_name);
+        }
+        else
+            out += NameTable::get().view(ref);
+    }
+}
+
+AsyncKillLogger::AsyncKillLogger(const std::string &filename, AsyncLoggerConfig _config)
+    : logger_id(next_logger_id++), config(_config), file(filename, std::ios::app)
+{
+    config.ring_capacity = std::max<size_t>(2, config.ring_capacity);
+    writer = std::thread(&AsyncKillLogger::run, this);
+}
+
+AsyncKillLogger::~AsyncKillLogger()
+{
+    {
+        std::lock_guard<std::mutex> lck(wake_mtx);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    writer.join();
+}
+
+AsyncKillLogger::Ring &AsyncKillLogger::local_ring()
+{
+    for (auto &entry : lease.entries)
+        if (entry.logger_id == logger_id)
+            return *static_cast<Ring *>(entry.ring.get());
+
+    std::shared_ptr<Ring> ring;
+    {
+        std::lock_guard<std::mutex> lck(rings_mtx);
+        for (auto &candidate : rings)
+        {
+            bool expected = false;
+            if (candidate->owned.compare_exchange_strong(expected, true))
+            {
+                ring = candidate;
+                break;
+            }
+        }
+        if (!ring)
+        {
+            ring = std::make_shared<Ring>(config.ring_capacity);
+            rings.push_back(ring);
+        }
+    }
+
+    lease.entries.push_back({logger_id, ring, &ring->owned});
+    return *ring;
+}
+
+void AsyncKillLogger::wake()
+{
+    {
+        std::lock_guard<std::mutex> lck(wake_mtx);
+        flush_requested++;
+    }
+    wake_cv.notify_all();
+}
+
+void AsyncKillLogger::log(const KillLogRecord &record)
+{
+    Ring &ring = local_ring();
+    const size_t capacity = ring.records.size();
+    const size_t tail = ring.tail.load(std::memory_order_relaxed);
+
+    if (tail - ring.head.load(std::memory_order_acquire) >= capacity)
+    {
+        stall_count++;
+        wake();
+        while (tail - ring.head.load(std::memory_order_acquire) >= capacity)
+            std::this_thread::yield();
+    }
+
+    ring.records[tail % capacity] = record;
+    ring.tail.store(tail + 1, std::memory_order_release);
+}
+
+void AsyncKillLogger::log_kill(const NPC &attacker, const NPC &defender)
+{
+    KillLogRecord record;
+    record.time = static_cast<int64_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    copy_field(record.attacker_type, attacker.get_type_str());
+    record.attacker_name = attacker.name_ref();
+    copy_field(record.defender_type, defender.get_type_str());
+    record.defender_name = defender.name_ref();
+    log(record);
+}
+
+void AsyncKillLogger::flush()
+{
+    std::unique_lock<std::mutex> lck(wake_mtx);
+    const uint64_t target = ++flush_requested;
+    wake_cv.notify_all();
+    flushed_cv.wait(lck, [this, target] { return flush_completed >= target || stopping; });
+}
+
+void AsyncKillLogger::format(const KillLogRecord &record, std::string &out)
+{
+    std::time_t time = static_cast<std::time_t>(record.time);
+    out += "\n=== Kill ===\n";
+    out += "Time: ";
+    out += std::ctime(&time);
+    out += "Atacker: ";
+    out += record.attacker_type;
+    out += " \"";
+    append_name(out, record.attacker_name);
+    out += "\"\nDefender: ";
+    out += record.defender_type;
+    out += " \"";
+    append_name(out, record.defender_name);
+    out += "\"\n----------------\n";
+}
+
+size_t AsyncKillLogger::drain(std::string &buffer)
+{
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+        std::lock_guard<std::mutex> lck(rings_mtx);
+        snapshot = rings;
+    }
+
+    size_t count = 0;
+    for (auto &ring : snapshot)
+    {
+        const size_t capacity = ring->records.size();
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        const size_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head, ++count)
+            format(ring->records[head % capacity], buffer);
+        ring->head.store(head, std::memory_order_release);
+    }
+    return count;
+}
+
+void AsyncKillLogger::run()
+{
+    std::string buffer;
+    while (true)
+    {
+        uint64_t target;
+        bool last;
+        {
+            std::unique_lock<std::mutex> lck(wake_mtx);
+            wake_cv.wait_for(lck, config.flush_interval,
+                             [this] { return stopping || flush_requested > flush_completed; });
+            target = flush_requested;
+            last = stopping;
+        }
+
+        buffer.clear();
+        size_t count = drain(buffer);
+        if (count > 0 && file.is_open())
+        {
+            file.write(buffer.data(), buffer.size());
+            file.flush();
+        }
+        written_count += count;
+
+        {
+            std::lock_guard<std::mutex> lck(wake_mtx);
+            flush_completed = std::max(flush_completed, target);
+        }
+        flushed_cv.notify_all();
+
+        if (last)
+            break;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "npc.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Names are kept as NPC::name_ref() values and only turned into text by
+// the writer, so a record is small and no name is ever cut short.
+struct KillLogRecord
+{
+    int64_t time;
+    char attacker_type[16];
+    uint32_t attacker_name;
+    char defender_type[16];
+    uint32_t defender_name;
+};
+
+struct AsyncLoggerConfig
+{
+    std::chrono::milliseconds flush_interval{100};
+    size_t ring_capacity{1024};
+};
+
+// Kill log writer that keeps file I/O off the fight threads. Every producer
+// thread appends fixed-size records to its own single-producer ring; a
+// background thread drains all rings, formats the records and writes them
+// in one batch per flush interval. A producer whose ring is full waits for
+// the writer (backpressure), and the destructor drains every ring, so no
+// record is dropped.
+class AsyncKillLogger
+{
+private:
+    struct Ring
+    {
+        std::vector<KillLogRecord> records;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<bool> owned{true};
+
+        explicit Ring(size_t capacity) : records(capacity) {}
+    };
+
+    const uint64_t logger_id;
+    AsyncLoggerConfig config;
+    std::ofstream file;
+
+    std::mutex rings_mtx;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    std::mutex wake_mtx;
+    std::condition_variable wake_cv;
+    std::condition_variable flushed_cv;
+    bool stopping{false};
+    uint64_t flush_requested{0};
+    uint64_t flush_completed{0};
+
+    std::atomic<uint64_t> written_count{0};
+    std::atomic<uint64_t> stall_count{0};
+    std::thread writer;
+
+    Ring &local_ring();
+    size_t drain(std::string &buffer);
+    void run();
+    void wake();
+
+public:
+    explicit AsyncKillLogger(const std::string &filename, AsyncLoggerConfig config = {});
+    ~AsyncKillLogger();
+
+    AsyncKillLogger(const AsyncKillLogger &) = delete;
+    AsyncKillLogger &operator=(const AsyncKillLogger &) = delete;
+
+    bool is_open() const { return file.is_open(); }
+
+    void log(const KillLogRecord &record);
+    void log_kill(const NPC &attacker, const NPC &defender);
+    void flush();
+
+    uint64_t written() const { return written_count.load(); }
+    uint64_t stalls() const { return stall_count.load(); }
+
+    static void format(const KillLogRecord &record, std::string &out);
+};
@@ -0,0 +1,680 @@
+#include <benchmark/benchmark.h>
+#include "npc.h"
+#include "Dragon.h"
+#include "StrangeKnight.h"
+#include "Elf.h"
+#include "world.h"
+#include "distance_kernel.h"
+#include "fight_queue.h"
+#include "fight_manager.h"
+#include "fight_rules.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "factory.h"
+#include "generator.h"
+#include "async_logger.h"
+#include "event_bus.h"
+#include "grid_renderer.h"
+#include "text_loader.h"
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    const int DISTANCE = 10;
+
+    // Map side grows with sqrt(N) so density (and the neighbour count per NPC)
+    // stays constant across sizes; otherwise no index could scale linearly.
+    int map_side(size_t count)
+    {
+        return std::max(20, static_cast<int>(std::sqrt(static_cast<double>(count)) * 20));
+    }
+
+    std::vector<std::shared_ptr<NPC>> make_world(size_t count, int side)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> coord(0, side);
+        std::vector<std::shared_ptr<NPC>> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            int x = coord(rng);
+            int y = coord(rng);
+            switch (i % 3)
+            {
+            case 0: result.push_back(std::make_shared<Dragon>(x, y, "D")); break;
+            case 1: result.push_back(std::make_shared<Knight>(x, y, "K")); break;
+            default: result.push_back(std::make_shared<Elf>(x, y, "E")); break;
+            }
+        }
+        return result;
+    }
+
+    void fill(World &world, size_t count)
+    {
+        world.reserve(count);
+        for (auto &npc : make_world(count, map_side(count)))
+            world.add(npc);
+    }
+
+    // World sizes from 10 to 1M NPCs.
+    void world_sizes(benchmark::internal::Benchmark *b)
+    {
+        b->RangeMultiplier(10)->Range(10, 1000000);
+    }
+
+    void finish(benchmark::State &state)
+    {
+        state.SetComplexityN(state.range(0));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+// ---- proximity ------------------------------------------------------------
+
+static void BM_IsClose(benchmark::State &state)
+{
+    auto a = std::make_shared<Dragon>(0, 0, "A");
+    auto b = std::make_shared<Elf>(3, 4, "B");
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a->is_close(b, DISTANCE));
+}
+BENCHMARK(BM_IsClose);
+
+// Quadratic, so it stops at 10k; larger worlds would run for hours.
+static void BM_PairwiseScan(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    auto npcs = make_world(count, map_side(count));
+
+    for (auto _ : state)
+    {
+        size_t pairs = 0;
+        for (auto &npc : npcs)
+            for (auto &other : npcs)
+                if (other != npc && npc->is_close(other, DISTANCE))
+                    ++pairs;
+        benchmark::DoNotOptimize(pairs);
+    }
+    finish(state);
+}
+BENCHMARK(BM_PairwiseScan)->RangeMultiplier(10)->Range(10, 10000)->Complexity();
+
+// One query point against a contiguous block of coordinates.
+template <size_t (*Kernel)(int, int, const int *, const int *, size_t, int, uint32_t *)>
+static void BM_DistanceBlock(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> coord(0, 100);
+    std::vector<int> xs(count);
+    std::vector<int> ys(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        xs[i] = coord(rng);
+        ys[i] = coord(rng);
+    }
+    std::vector<uint32_t> hits(count);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Kernel(50, 50, xs.data(), ys.data(), count, DISTANCE, hits.data()));
+    state.SetLabel(Kernel == within_radius ? distance_kernel_name() : "scalar");
+    finish(state);
+}
+BENCHMARK_TEMPLATE(BM_DistanceBlock, within_radius)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_DistanceBlock, within_radius_scalar)->RangeMultiplier(8)->Range(8, 4096);
+
+// The pre-kernel path: one is_close call per pair.
+static void BM_DistanceIsClose(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    auto query = std::make_shared<Dragon>(50, 50, "Q");
+    auto npcs = make_world(count, 100);
+
+    for (auto _ : state)
+    {
+        size_t found = 0;
+        for (auto &npc : npcs)
+            found += query->is_close(npc, DISTANCE);
+        benchmark::DoNotOptimize(found);
+    }
+    finish(state);
+}
+BENCHMARK(BM_DistanceIsClose)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_GridScan(benchmark::State &state)
+{
+    World world;
+    fill(world, state.range(0));
+    world.build_grid(DISTANCE);
+
+    for (auto _ : state)
+    {
+        size_t pairs = 0;
+        for (size_t i = 0; i < world.size(); ++i)
+            world.for_each_neighbour(i, DISTANCE, [&](size_t j)
+            {
+                if (j != i)
+                    ++pairs;
+            });
+        benchmark::DoNotOptimize(pairs);
+    }
+    finish(state);
+}
+BENCHMARK(BM_GridScan)->Apply(world_sizes)->Complexity();
+
+// Crowded map: many NPCs per cell, where the batch kernel does the work.
+static void BM_GridScanDense(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    World world;
+    world.reserve(count);
+    for (auto &npc : make_world(count, 100))
+        world.add(npc);
+    world.build_grid(DISTANCE);
+
+    for (auto _ : state)
+    {
+        size_t pairs = 0;
+        for (size_t i = 0; i < world.size(); ++i)
+            world.for_each_neighbour(i, DISTANCE, [&](size_t j)
+            {
+                if (j != i)
+                    ++pairs;
+            });
+        benchmark::DoNotOptimize(pairs);
+    }
+    finish(state);
+}
+BENCHMARK(BM_GridScanDense)->RangeMultiplier(10)->Range(100, 10000);
+
+// ---- world storage ----------------------------------------------------------
+
+static void BM_GridMove(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    const int side = map_side(count);
+    World world;
+    fill(world, count);
+    world.build_grid(DISTANCE);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> shift(-20, 19);
+    for (auto _ : state)
+        for (size_t i = 0; i < world.size(); ++i)
+            world.move_at(i, shift(rng), shift(rng), side, side);
+    finish(state);
+}
+BENCHMARK(BM_GridMove)->Apply(world_sizes)->Complexity();
+
+static void BM_SetIteration(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    auto npcs = make_world(count, map_side(count));
+    set_t set(npcs.begin(), npcs.end());
+
+    for (auto _ : state)
+    {
+        long long sum = 0;
+        for (auto &npc : set)
+            if (npc->is_alive())
+                sum += npc->position().first + npc->position().second;
+        benchmark::DoNotOptimize(sum);
+    }
+    finish(state);
+}
+BENCHMARK(BM_SetIteration)->Apply(world_sizes);
+
+static void BM_WorldIteration(benchmark::State &state)
+{
+    World world;
+    fill(world, state.range(0));
+
+    for (auto _ : state)
+    {
+        long long sum = 0;
+        const int *xs = world.x_data();
+        const int *ys = world.y_data();
+        const uint8_t *alive = world.alive_data();
+        for (size_t i = 0; i < world.size(); ++i)
+            if (alive[i])
+                sum += xs[i] + ys[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    finish(state);
+}
+BENCHMARK(BM_WorldIteration)->Apply(world_sizes);
+
+// One combat-view frame (rasterize + diff) while a tenth of the NPCs move;
+// the bytes counter is what would reach the terminal.
+static void BM_RenderFrame(benchmark::State &state)
+{
+    const int side = map_side(10000);
+    World world;
+    fill(world, 10000);
+    GridRenderer renderer(state.range(0), state.range(0));
+    renderer.draw(world, side, side);
+    renderer.compose("");
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> shift(-20, 19);
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < world.size(); i += 10)
+            world.move_at(i, shift(rng), shift(rng), side, side);
+        renderer.draw(world, side, side);
+        bytes += renderer.compose("").size();
+    }
+    state.counters["bytes/frame"] = benchmark::Counter(static_cast<double>(bytes) / state.iterations());
+}
+BENCHMARK(BM_RenderFrame)->Arg(20)->Arg(80)->Arg(200);
+
+// ---- fight rules -----------------------------------------------------------------
+
+static void BM_FightOutcomes(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> kind(DragonType, ElfType);
+    std::vector<NpcType> attackers(count);
+    std::vector<NpcType> defenders(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        attackers[i] = static_cast<NpcType>(kind(rng));
+        defenders[i] = static_cast<NpcType>(kind(rng));
+    }
+    std::vector<uint8_t> outcomes(count);
+
+    for (auto _ : state)
+    {
+        fight_outcomes(attackers.data(), defenders.data(), outcomes.data(), count);
+        benchmark::DoNotOptimize(outcomes.data());
+    }
+    finish(state);
+}
+BENCHMARK(BM_FightOutcomes)->RangeMultiplier(10)->Range(10, 100000);
+
+// ---- fight queue --------------------------------------------------------------
+
+static void BM_QueuePushPop(benchmark::State &state)
+{
+    MpmcQueue<FightEvent> queue(1 << 16);
+    const NpcHandle a{0, 0};
+    const NpcHandle b{1, 0};
+    std::vector<FightEvent> batch(state.range(0));
+
+    for (auto _ : state)
+    {
+        for (int64_t i = 0; i < state.range(0); ++i)
+            queue.try_push({a, b});
+        benchmark::DoNotOptimize(queue.try_pop_bulk(batch.begin(), batch.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QueuePushPop)->Arg(1)->Arg(64)->Arg(1024);
+
+static void BM_QueueProducerConsumer(benchmark::State &state)
+{
+    const int64_t per_iteration = 1 << 16;
+    MpmcQueue<uint64_t> queue(1 << 14);
+
+    for (auto _ : state)
+    {
+        std::thread consumer([&queue]()
+        {
+            std::vector<uint64_t> batch(256);
+            while (queue.pop_wait_bulk(batch.begin(), batch.size()) > 0)
+            {
+            }
+        });
+        for (int64_t i = 0; i < per_iteration; ++i)
+            while (!queue.try_push(uint64_t(i)))
+                std::this_thread::yield();
+        queue.close();
+        consumer.join();
+        queue.reopen();
+    }
+    state.SetItemsProcessed(state.iterations() * per_iteration);
+}
+BENCHMARK(BM_QueueProducerConsumer)->UseRealTime();
+
+// Enqueue N events among non-lethal pairs and wait for one worker to drain them.
+static void BM_FightManagerEnqueueDequeue(benchmark::State &state)
+{
+    const int64_t count = state.range(0);
+    World world;
+    std::vector<NpcHandle> knights;
+    for (int i = 0; i < 1024; ++i)
+        knights.push_back(world.handle_at(world.index_of(world.add(std::make_shared<Knight>(0, 0, "K")))));
+
+    FightManager &manager = FightManager::get();
+    manager.clear_events();
+    manager.start(world, 1);
+    for (auto _ : state)
+    {
+        for (int64_t i = 0; i < count; ++i)
+            while (!manager.add_event({knights[i % knights.size()], knights[(i * 31 + 1) % knights.size()]}))
+                std::this_thread::yield();
+        manager.wait_idle();
+    }
+    manager.stop();
+    finish(state);
+}
+BENCHMARK(BM_FightManagerEnqueueDequeue)->Apply(world_sizes)->UseRealTime();
+
+static void BM_FightPool(benchmark::State &state)
+{
+    const int64_t per_iteration = 1 << 15;
+    World world;
+    std::vector<NpcHandle> knights;
+    for (int i = 0; i < 4096; ++i)
+        knights.push_back(world.handle_at(world.index_of(world.add(std::make_shared<Knight>(0, 0, "K")))));
+
+    FightManager &manager = FightManager::get();
+    for (auto _ : state)
+    {
+        manager.start(world, state.range(0));
+        for (int64_t i = 0; i < per_iteration; ++i)
+            while (!manager.add_event({knights[i % knights.size()], knights[(i * 31 + 1) % knights.size()]}))
+                std::this_thread::yield();
+        manager.stop();
+    }
+    state.SetItemsProcessed(state.iterations() * per_iteration);
+}
+BENCHMARK(BM_FightPool)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// ---- factory ------------------------------------------------------------------
+
+static void BM_FactoryCreate(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    for (auto _ : state)
+    {
+        World world;
+        world.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            world.add(NPCFactory::create(static_cast<NpcType>(i % 3 + 1), i % 500, i % 499));
+        benchmark::DoNotOptimize(world.size());
+    }
+    finish(state);
+}
+BENCHMARK(BM_FactoryCreate)->Apply(world_sizes)->Unit(benchmark::kMicrosecond);
+
+// Baseline for BM_FactoryCreate: one global-heap allocation per NPC.
+static void BM_MakeSharedCreate(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    for (auto _ : state)
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            npcs.push_back(std::make_shared<Dragon>(i % 500, i % 499));
+        benchmark::DoNotOptimize(npcs.data());
+    }
+    finish(state);
+}
+BENCHMARK(BM_MakeSharedCreate)->Apply(world_sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_PooledCreate(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    for (auto _ : state)
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            npcs.push_back(make_pooled<Dragon>(i % 500, i % 499));
+        benchmark::DoNotOptimize(npcs.data());
+    }
+    finish(state);
+}
+BENCHMARK(BM_PooledCreate)->Apply(world_sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_FactoryLoad(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    std::stringstream text;
+    for (auto &npc : make_world(count, 500))
+        npc->save(text);
+    const std::string data = text.str();
+
+    for (auto _ : state)
+    {
+        std::istringstream is(data);
+        size_t loaded = 0;
+        while (auto npc = NPCFactory::load(is))
+            ++loaded;
+        benchmark::DoNotOptimize(loaded);
+    }
+    finish(state);
+}
+BENCHMARK(BM_FactoryLoad)->Apply(world_sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_Generate(benchmark::State &state)
+{
+    GeneratorConfig config;
+    config.count = state.range(0);
+    config.seed = 1;
+    config.distribution = Distribution::Clustered;
+    config.threads = state.range(1);
+    for (auto _ : state)
+    {
+        World world;
+        generate(world, config);
+        benchmark::DoNotOptimize(world.size());
+    }
+    finish(state);
+}
+BENCHMARK(BM_Generate)->ArgsProduct({{10000, 1000000}, {1, 2, 4, 8}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ---- persistence --------------------------------------------------------------
+
+static void BM_TextRoundTrip(benchmark::State &state)
+{
+    World world;
+    fill(world, state.range(0));
+
+    for (auto _ : state)
+    {
+        save(world, "bench_world.txt");
+        World loaded;
+        load(loaded, "bench_world.txt");
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove("bench_world.txt");
+    finish(state);
+}
+BENCHMARK(BM_TextRoundTrip)->Apply(world_sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_TextLoad(benchmark::State &state)
+{
+    World world;
+    fill(world, state.range(0));
+    save(world, "bench_world.txt");
+
+    TextLoadConfig config;
+    config.threads = state.range(1);
+    for (auto _ : state)
+    {
+        World loaded;
+        load_text(loaded, "bench_world.txt", config);
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove("bench_world.txt");
+    finish(state);
+}
+BENCHMARK(BM_TextLoad)->ArgsProduct({{100000, 1000000}, {1, 4}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SnapshotRoundTrip(benchmark::State &state)
+{
+    World world;
+    fill(world, state.range(0));
+
+    for (auto _ : state)
+    {
+        save_snapshot(world, "bench_world.npcw");
+        World loaded;
+        load_snapshot(loaded, "bench_world.npcw");
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove("bench_world.npcw");
+    finish(state);
+}
+BENCHMARK(BM_SnapshotRoundTrip)->Apply(world_sizes)->Unit(benchmark::kMillisecond);
+
+// ---- observers ----------------------------------------------------------------
+
+namespace
+{
+    struct NullObserver : IFightObserver
+    {
+        size_t count = 0;
+        void on_fight(const std::shared_ptr<NPC>, const std::shared_ptr<NPC>, bool) override { ++count; }
+    };
+
+    struct NullHandler
+    {
+        size_t count = 0;
+        void on_fight(const OnFight &) { ++count; }
+    };
+}
+
+static void BM_PerNpcObserverDispatch(benchmark::State &state)
+{
+    auto observer = std::make_shared<NullObserver>();
+    auto attacker = std::make_shared<Dragon>(0, 0, "A");
+    auto defender = std::make_shared<Knight>(0, 0, "D");
+    attacker->subscribe(observer);
+    attacker->subscribe(observer);
+
+    for (auto _ : state)
+        attacker->fight_notify(defender, true);
+    benchmark::DoNotOptimize(observer->count);
+}
+BENCHMARK(BM_PerNpcObserverDispatch);
+
+static void BM_EventBusDispatch(benchmark::State &state)
+{
+    EventBus bus;
+    NullHandler handler;
+    bus.subscribe<OnFight, NullHandler, &NullHandler::on_fight>(&handler);
+    bus.subscribe<OnFight, NullHandler, &NullHandler::on_fight>(&handler);
+    Dragon attacker(0, 0, "A");
+    Knight defender(0, 0, "D");
+
+    for (auto _ : state)
+        bus.publish(OnFight{attacker, defender, true});
+    benchmark::DoNotOptimize(handler.count);
+}
+BENCHMARK(BM_EventBusDispatch);
+
+static void BM_FileObserverKill(benchmark::State &state)
+{
+    auto attacker = std::make_shared<Dragon>(0, 0, "Attacker");
+    auto defender = std::make_shared<Knight>(0, 0, "Defender");
+    auto observer = FileObserver::get();
+
+    for (auto _ : state)
+        observer->on_fight(attacker, defender, true);
+    std::remove("log.txt");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FileObserverKill);
+
+static void BM_AsyncKillLog(benchmark::State &state)
+{
+    Dragon attacker(0, 0, "Attacker");
+    Knight defender(0, 0, "Defender");
+    {
+        AsyncKillLogger logger("bench_kills.log");
+        for (auto _ : state)
+            logger.log_kill(attacker, defender);
+    }
+    std::remove("bench_kills.log");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AsyncKillLog);
+
+// ---- full combat tick ---------------------------------------------------------
+
+// Combat kills most of a dense world within a few ticks, so every
+// iteration refills the world (untimed) and times its first tick; the
+// timed work is always a tick over `count` live NPCs. "alive" is the mean
+// population left after the timed tick.
+static SimulationConfig combat_config(size_t count)
+{
+    SimulationConfig config;
+    config.max_x = map_side(count);
+    config.max_y = config.max_x;
+    config.distance = DISTANCE;
+    config.seed = 1;
+    return config;
+}
+
+static void BM_CombatTick(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    const SimulationConfig config = combat_config(count);
+    std::unique_ptr<World> world;
+    std::unique_ptr<Simulation> simulation;
+    double alive = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        simulation.reset();
+        world = std::make_unique<World>();
+        fill(*world, count);
+        simulation = std::make_unique<Simulation>(*world, config);
+        state.ResumeTiming();
+
+        simulation->tick();
+
+        state.PauseTiming();
+        alive += world->alive_count();
+        state.ResumeTiming();
+    }
+    state.counters["alive"] = benchmark::Counter(alive, benchmark::Counter::kAvgIterations);
+    finish(state);
+}
+BENCHMARK(BM_CombatTick)->Apply(world_sizes)->Unit(benchmark::kMicrosecond)->Complexity();
+
+static void BM_CombatTickPool(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    const SimulationConfig config = combat_config(count);
+    std::unique_ptr<World> world;
+    std::unique_ptr<Simulation> simulation;
+    FightManager &manager = FightManager::get();
+    double alive = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        manager.stop();
+        simulation.reset();
+        world = std::make_unique<World>();
+        fill(*world, count);
+        simulation = std::make_unique<Simulation>(*world, config);
+        manager.clear_events();
+        manager.start(*world, std::thread::hardware_concurrency());
+        simulation->set_fight_manager(&manager);
+        state.ResumeTiming();
+
+        simulation->tick();
+
+        state.PauseTiming();
+        alive += world->alive_count();
+        state.ResumeTiming();
+    }
+    manager.stop();
+    state.counters["alive"] = benchmark::Counter(alive, benchmark::Counter::kAvgIterations);
+    finish(state);
+}
+BENCHMARK(BM_CombatTickPool)->Apply(world_sizes)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
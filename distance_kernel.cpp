@@ -0,0 +1,128 @@
+#include "distance_kernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NPC_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // dx*dx + dy*dy with dx, dy <= radius stays within int32 up to here.
+    const int max_simd_radius = 32767;
+
+    size_t scalar_range(int x, int y, const int *xs, const int *ys, size_t begin, size_t end, int radius, uint32_t *out)
+    {
+        const long long r2 = static_cast<long long>(radius) * radius;
+        size_t found = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const long long dx = xs[i] - x;
+            const long long dy = ys[i] - y;
+            out[found] = static_cast<uint32_t>(i);
+            found += (dx * dx + dy * dy <= r2);
+        }
+        return found;
+    }
+
+#ifdef NPC_X86_KERNELS
+    __attribute__((target("avx2")))
+    size_t within_radius_avx2(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out)
+    {
+        const __m256i qx = _mm256_set1_epi32(x);
+        const __m256i qy = _mm256_set1_epi32(y);
+        const __m256i r = _mm256_set1_epi32(radius);
+        const __m256i r2 = _mm256_set1_epi32(radius * radius);
+
+        size_t found = 0;
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(xs + i)), qx));
+            const __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(ys + i)), qy));
+            const __m256i d2 = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+            // Lanes with dx or dy above the radius may overflow d2, so they are rejected first.
+            const __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(dx, r), _mm256_cmpgt_epi32(dy, r)),
+                                                    _mm256_cmpgt_epi32(d2, r2));
+            unsigned bits = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFFu;
+            while (bits)
+            {
+                out[found++] = static_cast<uint32_t>(i + __builtin_ctz(bits));
+                bits &= bits - 1;
+            }
+        }
+        return found + scalar_range(x, y, xs, ys, i, count, radius, out + found);
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t within_radius_sse41(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out)
+    {
+        const __m128i qx = _mm_set1_epi32(x);
+        const __m128i qy = _mm_set1_epi32(y);
+        const __m128i r = _mm_set1_epi32(radius);
+        const __m128i r2 = _mm_set1_epi32(radius * radius);
+
+        size_t found = 0;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i dx = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(xs + i)), qx));
+            const __m128i dy = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ys + i)), qy));
+            const __m128i d2 = _mm_add_epi32(_mm_mullo_epi32(dx, dx), _mm_mullo_epi32(dy, dy));
+            const __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(dx, r), _mm_cmpgt_epi32(dy, r)),
+                                                 _mm_cmpgt_epi32(d2, r2));
+            unsigned bits = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(outside))) & 0xFu;
+            while (bits)
+            {
+                out[found++] = static_cast<uint32_t>(i + __builtin_ctz(bits));
+                bits &= bits - 1;
+            }
+        }
+        return found + scalar_range(x, y, xs, ys, i, count, radius, out + found);
+    }
+#endif
+
+    using kernel_t = size_t (*)(int, int, const int *, const int *, size_t, int, uint32_t *);
+
+    struct Kernel
+    {
+        kernel_t fn;
+        const char *name;
+    };
+
+    Kernel select_kernel()
+    {
+#ifdef NPC_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {within_radius_avx2, "avx2"};
+        if (__builtin_cpu_supports("sse4.1"))
+            return {within_radius_sse41, "sse4.1"};
+#endif
+        return {within_radius_scalar, "scalar"};
+    }
+
+    const Kernel &kernel()
+    {
+        static const Kernel selected = select_kernel();
+        return selected;
+    }
+}
+
+size_t within_radius_scalar(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out)
+{
+    return scalar_range(x, y, xs, ys, 0, count, radius, out);
+}
+
+size_t within_radius(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out)
+{
+    if (radius < 0)
+        return 0;
+    if (radius > max_simd_radius)
+        return within_radius_scalar(x, y, xs, ys, count, radius, out);
+    return kernel().fn(x, y, xs, ys, count, radius, out);
+}
+
+const char *distance_kernel_name()
+{
+    return kernel().name;
+}
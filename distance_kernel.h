@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch proximity test: writes to out the offsets i of every point
+// (xs[i], ys[i]) within radius of (x, y), in increasing order, and returns
+// how many were written. out must have room for count entries. Uses
+// integer squared distance; the SIMD paths (AVX2, SSE4.1) are picked at
+// runtime from what the CPU supports and give the same result as the
+// scalar one.
+size_t within_radius(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out);
+size_t within_radius_scalar(int x, int y, const int *xs, const int *ys, size_t count, int radius, uint32_t *out);
+
+// "avx2", "sse4.1" or "scalar".
+const char *distance_kernel_name();
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "npc.h"
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+struct OnFight
+{
+    NPC &attacker;
+    NPC &defender;
+    bool win;
+};
+
+struct OnKill
+{
+    NPC &attacker;
+    NPC &defender;
+};
+
+struct OnDeath
+{
+    NPC &npc;
+};
+
+struct OnMove
+{
+    npc_id id;
+    int from_x;
+    int from_y;
+    int to_x;
+    int to_y;
+};
+
+// World-level typed event dispatch. Handlers are a plain function pointer
+// plus a context pointer, so publishing is a loop over a vector with no
+// allocation and no reference counting. Subscribing and unsubscribing must
+// not run concurrently with publish; publish itself may be called from
+// several threads at once.
+class EventBus
+{
+private:
+    template <typename Event>
+    struct Handler
+    {
+        void (*fn)(void *, const Event &);
+        void *context;
+        uint32_t token;
+    };
+
+    std::tuple<std::vector<Handler<OnFight>>,
+               std::vector<Handler<OnKill>>,
+               std::vector<Handler<OnDeath>>,
+               std::vector<Handler<OnMove>>> handlers;
+    uint32_t next_token{1};
+
+    template <typename Event>
+    std::vector<Handler<Event>> &list() { return std::get<std::vector<Handler<Event>>>(handlers); }
+
+    template <typename Event>
+    const std::vector<Handler<Event>> &list() const { return std::get<std::vector<Handler<Event>>>(handlers); }
+
+public:
+    template <typename Event>
+    uint32_t subscribe(void (*fn)(void *, const Event &), void *context)
+    {
+        const uint32_t token = next_token++;
+        list<Event>().push_back({fn, context, token});
+        return token;
+    }
+
+    template <typename Event, typename T, void (T::*Method)(const Event &)>
+    uint32_t subscribe(T *object)
+    {
+        return subscribe<Event>([](void *context, const Event &event)
+        {
+            (static_cast<T *>(context)->*Method)(event);
+        }, object);
+    }
+
+    template <typename Event>
+    bool unsubscribe(uint32_t token)
+    {
+        auto &entries = list<Event>();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->token == token)
+            {
+                entries.erase(it);
+                return true;
+            }
+        return false;
+    }
+
+    template <typename Event>
+    bool has_subscribers() const
+    {
+        return !list<Event>().empty();
+    }
+
+    template <typename Event>
+    void publish(const Event &event) const
+    {
+        for (const auto &handler : list<Event>())
+            handler.fn(handler.context, event);
+    }
+};
@@ -4,35 +4,33 @@
 #include "StrangeKnight.h"
 #include "Elf.h"
 #include "observers.h"
+#include "world.h"
+#include "npc_pool.h"
+#include "text_loader.h"
+#include <algorithm>
 #include <sstream>
 
 class NPCFactory
 {
 public:
-    static std::shared_ptr<NPC> create(NpcType type, int x, int y, const std::string& name = "")
+    static std::shared_ptr<NPC> create(NpcType type, int x, int y, std::string_view name = "")
     {
         std::shared_ptr<NPC> result;
         switch (type)
         {
         case DragonType:
-            result = std::make_shared<Dragon>(x, y, name);
+            result = make_pooled<Dragon>(x, y, name);
             break;
         case KnightType:
-            result = std::make_shared<Knight>(x, y, name);
+            result = make_pooled<Knight>(x, y, name);
             break;
         case ElfType:
-            result = std::make_shared<Elf>(x, y, name);
+            result = make_pooled<Elf>(x, y, name);
             break;
         default:
             return nullptr;
         }
         
-        if (result)
-        {
-            result->subscribe(TextObserver::get());
-            result->subscribe(FileObserver::get());
-        }
-        
         return result;
     }
     
@@ -45,25 +43,19 @@ public:
             switch (type)
             {
             case DragonType:
-                result = std::make_shared<Dragon>(is);
+                result = make_pooled<Dragon>(is);
                 break;
             case KnightType:
-                result = std::make_shared<Knight>(is);
+                result = make_pooled<Knight>(is);
                 break;
             case ElfType:
-                result = std::make_shared<Elf>(is);
+                result = make_pooled<Elf>(is);
                 break;
             default:
                 return nullptr;
             }
         }
         
-        if (result)
-        {
-            result->subscribe(TextObserver::get());
-            result->subscribe(FileObserver::get());
-        }
-        
         return result;
     }
     
@@ -79,7 +71,7 @@ public:
     }
 };
 
-void save(const set_t &array, const std::string &filename)
+inline void save(const set_t &array, const std::string &filename)
 {
     std::ofstream fs(filename);
     if (!fs.is_open())
@@ -87,7 +79,7 @@ void save(const set_t &array, const std::string &filename)
         return;
     }
     
-    fs << array.size() << std::endl;
+    fs << array.size() << '\n';
     for (auto &n : array)
         n->save(fs);
     
@@ -95,26 +87,36 @@ void save(const set_t &array, const std::string &filename)
     fs.close();
 }
 
-set_t load(const std::string &filename)
+inline void save(const World &world, const std::string &filename)
 {
-    set_t result;
-    std::ifstream is(filename);
-    if (is.good() && is.is_open())
+    std::ofstream fs(filename);
+    if (!fs.is_open())
     {
-        int count;
-        is >> count;
-        for (int i = 0; i < count; ++i)
-        {
-            auto npc = NPCFactory::load(is);
-            if (npc)
-                result.insert(npc);
-        }
-        is.close();
+        return;
     }
-    return result;
+    
+    fs << world.size() << '\n';
+    for (size_t i = 0; i < world.size(); ++i)
+        world.object(i)->save(fs);
+    
+    fs.flush();
+    fs.close();
 }
 
-void print_all(const set_t &array)
+inline set_t load(const std::string &filename)
+{
+    auto npcs = load_text(filename).npcs;
+    // Sorted input lets the set append instead of searching on every insert.
+    std::sort(npcs.begin(), npcs.end());
+    return set_t(npcs.begin(), npcs.end());
+}
+
+inline void load(World &world, const std::string &filename)
+{
+    load_text(world, filename);
+}
+
+inline void print_all(const set_t &array)
 {
     std::cout << "\n=== NPC List===" << std::endl;
     std::cout << "ALL: " << array.size() << std::endl;
@@ -132,4 +134,24 @@ void print_all(const set_t &array)
     std::cout << "\nAlive: " << alive_count << std::endl;
     std::cout << "Dead: " << (array.size() - alive_count) << std::endl;
     std::cout << "==================" << std::endl;
+}
+
+inline void print_all(const World &world)
+{
+    std::cout << "\n=== NPC List===" << std::endl;
+    std::cout << "ALL: " << world.size() << std::endl;
+    
+    const size_t alive_count = world.alive_count();
+    for (size_t i = 0; i < world.size(); ++i)
+    {
+        if (world.is_alive(i))
+        {
+            std::cout << (i + 1) << ". ";
+            world.object(i)->print();
+        }
+    }
+    
+    std::cout << "\nAlive: " << alive_count << std::endl;
+    std::cout << "Dead: " << (world.size() - alive_count) << std::endl;
+    std::cout << "==================" << std::endl;
 }
\ No newline at end of file
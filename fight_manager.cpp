@@ -0,0 +1,158 @@
+#include "fight_manager.h"
+#include "fight_rules.h"
+
+FightManager::~FightManager()
+{
+    stop();
+}
+
+bool FightManager::add_event(FightEvent event)
+{
+    outstanding++;
+    event.enqueued = NPC_METRIC_NOW();
+    if (events.try_push(std::move(event)))
+    {
+        NPC_METRIC_ADD(EventsEnqueued, 1);
+        return true;
+    }
+    finished(1);
+    return false;
+}
+
+void FightManager::clear_events()
+{
+    FightEvent event;
+    size_t count = 0;
+    while (events.try_pop(event))
+        ++count;
+    finished(count);
+}
+
+void FightManager::finished(size_t count)
+{
+    if (count == 0)
+        return;
+    if (outstanding.fetch_sub(count) == count)
+    {
+        std::lock_guard<std::mutex> lck(idle_mtx);
+        idle_cv.notify_all();
+    }
+}
+
+void FightManager::wait_idle()
+{
+    std::unique_lock<std::mutex> lck(idle_mtx);
+    idle_cv.wait(lck, [this] { return outstanding.load() == 0 || workers.empty(); });
+}
+
+size_t FightManager::pending() const
+{
+    return events.size();
+}
+
+void FightManager::resolve(NPC &attacker, NPC &defender)
+{
+    if (!attacker.is_alive() || !defender.is_alive())
+        return;
+
+    const uint8_t outcome = fight_outcome(attacker.get_type(), defender.get_type());
+    const bool attacker_wins = outcome & 1;
+    const bool defender_wins = outcome & 2;
+    attacker.fight_notify(defender, attacker_wins);
+    defender.fight_notify(attacker, defender_wins);
+
+    if (attacker_wins && defender_wins)
+    {
+        attacker.must_die();
+        defender.must_die();
+    }
+    else if (attacker_wins)
+    {
+        defender.must_die();
+    }
+    else if (defender_wins)
+    {
+        attacker.must_die();
+    }
+}
+
+bool FightManager::try_resolve(const FightEvent &event)
+{
+    NPC *attacker = world->resolve(event.attacker);
+    NPC *defender = world->resolve(event.defender);
+    if (!attacker || !defender || attacker == defender)
+        return true;
+    if (!attacker->try_engage())
+        return false;
+    if (!defender->try_engage())
+    {
+        attacker->disengage();
+        return false;
+    }
+
+    resolve(*attacker, *defender);
+    NPC_METRIC_RECORD(FightLatency, NPC_METRIC_NOW() - event.enqueued);
+
+    defender->disengage();
+    attacker->disengage();
+    return true;
+}
+
+void FightManager::start(World &_world, size_t worker_count)
+{
+    stop();
+    world = &_world;
+    events.reopen();
+    worker_count = std::max<size_t>(1, worker_count);
+    for (size_t i = 0; i < worker_count; ++i)
+        workers.emplace_back(std::ref(*this));
+}
+
+void FightManager::stop()
+{
+    events.close();
+    for (auto &worker : workers)
+        if (worker.joinable())
+            worker.join();
+    workers.clear();
+}
+
+size_t FightManager::worker_count() const
+{
+    return workers.size();
+}
+
+void FightManager::operator()()
+{
+    std::vector<FightEvent> batch(batch_size);
+    std::vector<FightEvent> deferred;
+    while (true)
+    {
+        size_t count = events.pop_wait_bulk(batch.begin(), batch_size);
+        if (count == 0)
+            break;
+        NPC_METRIC_ADD(EventsDequeued, count);
+        NPC_METRIC_RECORD(QueueDepth, events.size());
+
+        size_t done = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (try_resolve(batch[i]))
+                ++done;
+            else
+                deferred.push_back(batch[i]);
+        }
+
+        while (!deferred.empty())
+        {
+            std::this_thread::yield();
+            size_t kept = 0;
+            for (auto &event : deferred)
+                if (!try_resolve(event))
+                    deferred[kept++] = event;
+            done += deferred.size() - kept;
+            deferred.resize(kept);
+        }
+        finished(done);
+    }
+}
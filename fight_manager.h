@@ -0,0 +1,68 @@
+#pragma once
+
+#include "npc.h"
+#include "world.h"
+#include "fight_queue.h"
+#include "metrics.h"
+#include <thread>
+#include <type_traits>
+
+// Plain handles, so queueing and copying an event neither allocates nor
+// touches a reference count.
+struct FightEvent
+{
+    NpcHandle attacker;
+    NpcHandle defender;
+    // Metrics clock at add_event, for the enqueue-to-resolution latency.
+    uint64_t enqueued{0};
+};
+
+static_assert(std::is_trivially_copyable<FightEvent>::value, "FightEvent must stay a plain value");
+
+// Resolves fight events on a pool of worker threads. A worker engages both
+// NPCs of an event before resolving it, so an NPC takes part in at most one
+// fight at a time; events whose NPCs are busy are retried after the batch.
+// Events name NPCs of the world passed to start(); one whose handle went
+// stale (the NPC was removed) is dropped.
+class FightManager
+{
+private:
+    static constexpr size_t batch_size = 64;
+
+    MpmcQueue<FightEvent> events;
+    std::vector<std::thread> workers;
+    World *world{nullptr};
+
+    std::atomic<size_t> outstanding{0};
+    std::mutex idle_mtx;
+    std::condition_variable idle_cv;
+
+    void finished(size_t count);
+    FightManager() {}
+
+    bool try_resolve(const FightEvent &event);
+
+public:
+    ~FightManager();
+
+    static FightManager &get()
+    {
+        static FightManager instance;
+        return instance;
+    }
+
+    bool add_event(FightEvent event);
+    void clear_events();
+    size_t pending() const;
+
+    static void resolve(NPC &attacker, NPC &defender);
+
+    void wait_idle();
+
+    // The world must outlive the workers, i.e. until stop().
+    void start(World &world, size_t worker_count);
+    void stop();
+    size_t worker_count() const;
+
+    void operator()();
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's ring of
+// sequenced cells). Producers and consumers only touch atomics on the fast
+// path; the mutex and condition variable are used only to park consumers
+// when the queue is empty and to wake them again.
+template <typename T>
+class MpmcQueue
+{
+private:
+    static constexpr size_t cache_line = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(cache_line) std::atomic<size_t> enqueue_pos{0};
+    alignas(cache_line) std::atomic<size_t> dequeue_pos{0};
+    alignas(cache_line) std::atomic<int> waiters{0};
+    std::atomic<bool> closed{false};
+
+    std::mutex wait_mtx;
+    std::condition_variable wait_cv;
+
+    static size_t round_up(size_t capacity)
+    {
+        size_t result = 2;
+        while (result < capacity)
+            result <<= 1;
+        return result;
+    }
+
+    // The read of waiters is an RMW so it is ordered against a consumer's
+    // fetch_add before it re-checks the queue: either the consumer sees the
+    // new item or we see the consumer and notify it.
+    void wake(bool all)
+    {
+        if (waiters.fetch_add(0) == 0)
+            return;
+        std::lock_guard<std::mutex> lck(wait_mtx);
+        if (all)
+            wait_cv.notify_all();
+        else
+            wait_cv.notify_one();
+    }
+
+public:
+    explicit MpmcQueue(size_t capacity = 1 << 16)
+        : mask(round_up(capacity) - 1), cells(new Cell[mask + 1])
+    {
+        for (size_t i = 0; i <= mask; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    size_t size() const
+    {
+        const size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        const size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    bool try_push(T &&value)
+    {
+        Cell *cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        wake(false);
+        return true;
+    }
+
+    bool try_pop(T &out)
+    {
+        Cell *cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        out = std::move(cell->data);
+        cell->data = T{};
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to max_count items into out, without blocking.
+    template <typename OutIt>
+    size_t try_pop_bulk(OutIt out, size_t max_count)
+    {
+        size_t count = 0;
+        T value;
+        while (count < max_count && try_pop(value))
+        {
+            *out++ = std::move(value);
+            ++count;
+        }
+        return count;
+    }
+
+    // Pops up to max_count items, parking the calling thread while the queue
+    // is empty. Returns 0 only once the queue has been closed and drained.
+    template <typename OutIt>
+    size_t pop_wait_bulk(OutIt out, size_t max_count)
+    {
+        while (true)
+        {
+            size_t count = try_pop_bulk(out, max_count);
+            if (count > 0)
+                return count;
+            if (closed.load())
+                return try_pop_bulk(out, max_count);
+
+            std::unique_lock<std::mutex> lck(wait_mtx);
+            waiters.fetch_add(1);
+            wait_cv.wait(lck, [this] { return !empty() || closed.load(); });
+            waiters.fetch_sub(1);
+        }
+    }
+
+    void close()
+    {
+        closed.store(true);
+        wake(true);
+    }
+
+    void reopen()
+    {
+        closed.store(false);
+    }
+
+    bool is_closed() const { return closed.load(); }
+
+    void clear()
+    {
+        T value;
+        while (try_pop(value))
+        {
+        }
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "npc.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Who beats whom, fixed at compile time. Each NPC kind lists the kinds it
+// defeats in its FightRule specialisation and the lookup table is generated
+// from them, so a new kind needs an NpcType value and one specialisation
+// here; kinds without a specialisation defeat nobody.
+constexpr uint32_t type_bit(NpcType type)
+{
+    return 1u << type;
+}
+
+template <NpcType T>
+struct FightRule
+{
+    static constexpr uint32_t defeats = 0;
+};
+
+template <>
+struct FightRule<DragonType>
+{
+    static constexpr uint32_t defeats = ~0u;
+};
+
+template <>
+struct FightRule<KnightType>
+{
+    static constexpr uint32_t defeats = type_bit(DragonType);
+};
+
+template <>
+struct FightRule<ElfType>
+{
+    static constexpr uint32_t defeats = type_bit(KnightType);
+};
+
+namespace detail
+{
+    template <size_t... I>
+    constexpr std::array<uint32_t, sizeof...(I)> make_fight_table(std::index_sequence<I...>)
+    {
+        return {FightRule<static_cast<NpcType>(I)>::defeats...};
+    }
+}
+
+static_assert(NpcTypeCount <= 32, "fight rules keep one bit per NPC kind");
+
+inline constexpr std::array<uint32_t, NpcTypeCount> fight_table =
+    detail::make_fight_table(std::make_index_sequence<NpcTypeCount>{});
+
+constexpr bool beats(NpcType attacker, NpcType defender)
+{
+    return (fight_table[attacker] >> defender) & 1u;
+}
+
+// Bit 0: the attacker wins, bit 1: the defender wins. Both set is a mutual kill.
+constexpr uint8_t fight_outcome(NpcType attacker, NpcType defender)
+{
+    return static_cast<uint8_t>(beats(attacker, defender) | (beats(defender, attacker) << 1));
+}
+
+inline void fight_outcomes(const NpcType *attackers, const NpcType *defenders, uint8_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = fight_outcome(attackers[i], defenders[i]);
+}
+
+static_assert(beats(DragonType, DragonType) && beats(DragonType, KnightType) && beats(DragonType, ElfType));
+static_assert(beats(KnightType, DragonType) && !beats(KnightType, KnightType) && !beats(KnightType, ElfType));
+static_assert(beats(ElfType, KnightType) && !beats(ElfType, DragonType) && !beats(ElfType, ElfType));
@@ -0,0 +1,149 @@
+#include "generator.h"
+#include "factory.h"
+#include "rng.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    const uint64_t npc_stream = ~0ULL;
+    const uint64_t centre_stream = ~1ULL;
+    const size_t min_chunk = 4096;
+    const double two_pi = 6.283185307179586;
+
+    struct Centre
+    {
+        double x;
+        double y;
+    };
+
+    // Uniform double in [0, 1).
+    double unit(uint64_t bits)
+    {
+        return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    NpcType pick_type(const GeneratorConfig &config, uint32_t total, uint32_t bits)
+    {
+        uint32_t v = bounded(bits, total);
+        for (int t = 0; t < NpcTypeCount; ++t)
+        {
+            if (v < config.ratios[t])
+                return static_cast<NpcType>(t);
+            v -= config.ratios[t];
+        }
+        return Unknown;
+    }
+
+    std::pair<int, int> clamp_to_map(const GeneratorConfig &config, double x, double y)
+    {
+        return {std::clamp(static_cast<int>(std::lround(x)), 0, config.max_x),
+                std::clamp(static_cast<int>(std::lround(y)), 0, config.max_y)};
+    }
+
+    std::pair<int, int> place(const GeneratorConfig &config, const std::vector<Centre> &centres, uint64_t r)
+    {
+        const uint64_t r2 = splitmix64(r);
+        if (config.distribution == Distribution::Uniform || centres.empty())
+            return {static_cast<int>(bounded(static_cast<uint32_t>(r >> 32), config.max_x + 1)),
+                    static_cast<int>(bounded(static_cast<uint32_t>(r2), config.max_y + 1))};
+
+        const Centre &centre = centres[bounded(static_cast<uint32_t>(r >> 32), static_cast<uint32_t>(centres.size()))];
+        const double angle = two_pi * unit(splitmix64(r2));
+        double radius;
+        if (config.distribution == Distribution::Clustered)
+            radius = config.spread * std::sqrt(unit(r2));
+        else
+            radius = config.spread * std::sqrt(-2.0 * std::log(1.0 - unit(r2)));
+        return clamp_to_map(config, centre.x + radius * std::cos(angle), centre.y + radius * std::sin(angle));
+    }
+}
+
+void generate(World &world, const GeneratorConfig &config)
+{
+    uint64_t sum = 0;
+    for (uint32_t ratio : config.ratios)
+        sum += ratio;
+    if (config.count == 0 || sum == 0 || sum > std::numeric_limits<uint32_t>::max())
+        return;
+    const uint32_t total = static_cast<uint32_t>(sum);
+
+    std::vector<Centre> centres;
+    if (config.distribution != Distribution::Uniform)
+        for (size_t c = 0; c < config.centres; ++c)
+        {
+            const uint64_t r = random_at(config.seed, centre_stream, c);
+            centres.push_back({unit(r) * config.max_x, unit(splitmix64(r)) * config.max_y});
+        }
+
+    // NPC i is named NPC_(first_name + i) whichever worker creates it.
+    const uint32_t first_name = NPC::reserve_auto_names(static_cast<uint32_t>(config.count));
+    std::vector<std::shared_ptr<NPC>> created(config.count);
+    auto work = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint64_t r = random_at(config.seed, npc_stream, i);
+            const NpcType type = pick_type(config, total, static_cast<uint32_t>(r));
+            const auto [x, y] = place(config, centres, r);
+            created[i] = NPCFactory::create(type, x, y);
+            if (created[i])
+                created[i]->set_auto_name(first_name + static_cast<uint32_t>(i));
+        }
+    };
+
+    size_t threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (config.count + min_chunk - 1) / min_chunk);
+    const size_t chunk = (config.count + threads - 1) / threads;
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t)
+        workers.emplace_back(work, std::min(config.count, t * chunk), std::min(config.count, (t + 1) * chunk));
+    work(0, std::min(config.count, chunk));
+    for (auto &worker : workers)
+        worker.join();
+
+    world.reserve(world.size() + config.count);
+    for (auto &npc : created)
+        if (npc)
+            world.add(npc);
+}
+
+bool parse_distribution(const std::string &text, Distribution &out)
+{
+    if (text == "uniform")
+        out = Distribution::Uniform;
+    else if (text == "clustered")
+        out = Distribution::Clustered;
+    else if (text == "gaussian")
+        out = Distribution::Gaussian;
+    else
+        return false;
+    return true;
+}
+
+bool parse_ratios(const std::string &text, GeneratorConfig &config)
+{
+    std::istringstream is(text);
+    uint32_t ratios[NpcTypeCount]{0};
+    char separator = ':';
+    for (int t = DragonType; t <= ElfType; ++t)
+    {
+        if (t != DragonType && !(is >> separator))
+            return false;
+        // operator>> would read "-1" as a huge unsigned value.
+        if (separator != ':' || !(is >> std::ws) || !std::isdigit(is.peek()) || !(is >> ratios[t]) ||
+            ratios[t] > max_ratio)
+            return false;
+    }
+    if (!is.eof() && is.peek() != EOF)
+        return false;
+    if (ratios[DragonType] + ratios[KnightType] + ratios[ElfType] == 0)
+        return false;
+    std::copy(std::begin(ratios), std::end(ratios), std::begin(config.ratios));
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "world.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class Distribution
+{
+    Uniform,
+    Clustered,
+    Gaussian
+};
+
+struct GeneratorConfig
+{
+    size_t count{0};
+    uint64_t seed{0};
+    int max_x{500};
+    int max_y{500};
+    // Relative weight of each kind, indexed by NpcType.
+    uint32_t ratios[NpcTypeCount]{0, 1, 1, 1};
+    Distribution distribution{Distribution::Uniform};
+    // Number of cluster / hotspot centres.
+    size_t centres{8};
+    // Cluster radius, or the standard deviation of a Gaussian hotspot.
+    double spread{25.0};
+    // 0 picks std::thread::hardware_concurrency().
+    size_t threads{0};
+};
+
+// Adds config.count seeded NPCs to the world. Every NPC is drawn from its
+// own counter-based stream (seed, index), so the world is the same for a
+// given seed whatever the number of threads the work is split over.
+void generate(World &world, const GeneratorConfig &config);
+
+bool parse_distribution(const std::string &text, Distribution &out);
+// Largest weight parse_ratios() accepts, so the sum always fits.
+constexpr uint32_t max_ratio = 1u << 24;
+
+// "D:K:E", e.g. "1:2:2", each 0..max_ratio.
+bool parse_ratios(const std::string &text, GeneratorConfig &config);
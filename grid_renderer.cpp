@@ -0,0 +1,124 @@
+#include "grid_renderer.h"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <unistd.h>
+
+namespace
+{
+    const char glyphs[NpcTypeCount] = {0, 'D', 'K', 'E'};
+}
+
+GridRenderer::GridRenderer(int _columns, int _rows)
+    : columns(std::clamp(_columns, 1, max_size)), rows(std::clamp(_rows, 1, max_size)), cell_width(columns <= 40 ? 3 : 1),
+      front(static_cast<size_t>(columns) * rows, 0), back(front.size(), 0)
+{
+}
+
+void GridRenderer::move_to(int row, int column)
+{
+    out += "\033[";
+    out += std::to_string(row);
+    out += ';';
+    out += std::to_string(column);
+    out += 'H';
+}
+
+void GridRenderer::put_cell(char c)
+{
+    if (cell_width == 1)
+    {
+        out += c ? c : ' ';
+        return;
+    }
+    out += '[';
+    out += c ? c : ' ';
+    out += ']';
+}
+
+void GridRenderer::draw(const World &world, int max_x, int max_y)
+{
+    std::fill(back.begin(), back.end(), 0);
+    const int64_t span_x = static_cast<int64_t>(max_x) + 1;
+    const int64_t span_y = static_cast<int64_t>(max_y) + 1;
+    for (size_t n = 0; n < world.size(); ++n)
+    {
+        const int x = world.x(n);
+        const int y = world.y(n);
+        if (x < 0 || x > max_x || y < 0 || y > max_y)
+            continue;
+        const size_t i = static_cast<size_t>(static_cast<int64_t>(x) * columns / span_x);
+        const size_t j = static_cast<size_t>(static_cast<int64_t>(y) * rows / span_y);
+        char &cell = back[i + j * columns];
+        if (!world.is_alive(n))
+            cell = '.';
+        else if (glyphs[world.type(n)])
+            cell = glyphs[world.type(n)];
+    }
+}
+
+const std::string &GridRenderer::compose(const std::string &status)
+{
+    out.clear();
+    if (redraw)
+    {
+        out += "\033[2J\033[1;1H";
+        out += "=== COMBAT MODE ===\n";
+        out += "D - Dragon, K - Knight, E - Elf, . - dead\n";
+        out += "Press Enter to stop\n\n";
+        for (int j = 0; j < rows; ++j)
+        {
+            for (int i = 0; i < columns; ++i)
+                put_cell(back[i + j * columns]);
+            out += '\n';
+        }
+    }
+    else
+    {
+        // Consecutive changed cells on a row need no cursor move between them.
+        size_t cursor = back.size();
+        for (size_t k = 0; k < back.size(); ++k)
+        {
+            if (back[k] == front[k])
+                continue;
+            if (k != cursor)
+                move_to(header_rows + 1 + static_cast<int>(k / columns),
+                        static_cast<int>(k % columns) * cell_width + 1);
+            put_cell(back[k]);
+            cursor = (k + 1) % columns ? k + 1 : back.size();
+        }
+    }
+
+    move_to(header_rows + rows + 2, 1);
+    for (char c : status)
+    {
+        if (c == '\n')
+            out += "\033[K";
+        out += c;
+    }
+    out += "\033[J";
+
+    front.swap(back);
+    redraw = false;
+    return out;
+}
+
+void GridRenderer::present(const std::string &status)
+{
+    compose(status);
+    std::cout.flush();
+    const char *data = out.data();
+    size_t left = out.size();
+    while (left > 0)
+    {
+        const ssize_t written = ::write(STDOUT_FILENO, data, left);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+}
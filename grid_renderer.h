@@ -0,0 +1,47 @@
+#pragma once
+
+#include "world.h"
+#include <string>
+#include <vector>
+
+// Terminal view of the combat map. draw() rasterizes the world into a back
+// frame; compose() turns it into an update that rewrites only the cells
+// differing from the front frame, addressed with cursor moves, followed by
+// the status block. present() sends the update with a single write.
+//
+// Cells print as "[c]" up to 40 columns and as one character beyond that.
+// Each side is clamped to 1..max_size.
+class GridRenderer
+{
+private:
+    int columns;
+    int rows;
+    int cell_width;
+    std::vector<char> front;
+    std::vector<char> back;
+    std::string out;
+    bool redraw{true};
+
+    void move_to(int row, int column);
+    void put_cell(char c);
+
+public:
+    static constexpr int default_size = 20;
+    // Larger grids would not fit any terminal; the frames stay small.
+    static constexpr int max_size = 500;
+    static constexpr int header_rows = 4;
+
+    GridRenderer(int columns = default_size, int rows = default_size);
+
+    int width() const { return columns; }
+    int height() const { return rows; }
+
+    // Makes the next frame a full redraw, e.g. after other output scrolled
+    // the terminal.
+    void invalidate() { redraw = true; }
+
+    // Where several NPCs share a cell the last one in dense order shows.
+    void draw(const World &world, int max_x, int max_y);
+    const std::string &compose(const std::string &status);
+    void present(const std::string &status);
+};
@@ -0,0 +1,125 @@
+#include "kill_stats.h"
+#include <algorithm>
+
+namespace
+{
+    const char *const type_labels[NpcTypeCount] = {"Unknown", "Dragon", "Knight", "Elf"};
+    constexpr size_t shown_buckets = 10;
+}
+
+KillStats::KillStats(uint64_t _ticks_per_bucket) : ticks_per_bucket(std::max<uint64_t>(1, _ticks_per_bucket))
+{
+}
+
+KillStats::~KillStats()
+{
+    detach();
+}
+
+void KillStats::attach(World &_world)
+{
+    detach();
+    world = &_world;
+    token = world->events().subscribe<OnKill, KillStats, &KillStats::on_kill>(this);
+}
+
+void KillStats::detach()
+{
+    if (!world)
+        return;
+    world->events().unsubscribe<OnKill>(token);
+    world = nullptr;
+    token = 0;
+}
+
+void KillStats::reset()
+{
+    for (auto &row : matrix)
+        for (auto &cell : row)
+            cell.store(0, std::memory_order_relaxed);
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    current_bucket.store(0, std::memory_order_relaxed);
+}
+
+void KillStats::on_kill(const OnKill &event)
+{
+    record(event.attacker.get_type(), event.defender.get_type());
+}
+
+void KillStats::record(NpcType attacker, NpcType defender)
+{
+    matrix[attacker][defender].fetch_add(1, std::memory_order_relaxed);
+    const uint64_t bucket = current_bucket.load(std::memory_order_relaxed);
+    buckets[bucket % bucket_count].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Buckets the stream skips over had no kills; they are cleared before the
+// ring reuses them.
+void KillStats::begin_tick(uint64_t tick)
+{
+    const uint64_t bucket = tick / ticks_per_bucket;
+    const uint64_t last = current_bucket.load(std::memory_order_relaxed);
+    if (bucket <= last)
+        return;
+    const uint64_t first = std::max(last + 1, bucket >= bucket_count ? bucket - bucket_count + 1 : 0);
+    for (uint64_t b = first; b <= bucket; ++b)
+        buckets[b % bucket_count].store(0, std::memory_order_relaxed);
+    current_bucket.store(bucket, std::memory_order_relaxed);
+}
+
+uint64_t KillStats::kills(NpcType attacker, NpcType defender) const
+{
+    return matrix[attacker][defender].load(std::memory_order_relaxed);
+}
+
+uint64_t KillStats::kills_by(NpcType attacker) const
+{
+    uint64_t result = 0;
+    for (const auto &cell : matrix[attacker])
+        result += cell.load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t KillStats::deaths(NpcType defender) const
+{
+    uint64_t result = 0;
+    for (const auto &row : matrix)
+        result += row[defender].load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t KillStats::kills() const
+{
+    uint64_t result = 0;
+    for (const auto &row : matrix)
+        for (const auto &cell : row)
+            result += cell.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::vector<uint64_t> KillStats::kill_rate(size_t count) const
+{
+    const uint64_t current = current_bucket.load(std::memory_order_relaxed);
+    count = std::min<uint64_t>({count, bucket_count, current + 1});
+    std::vector<uint64_t> result(count);
+    for (size_t i = 0; i < count; ++i)
+        result[i] = buckets[(current + 1 - count + i) % bucket_count].load(std::memory_order_relaxed);
+    return result;
+}
+
+void KillStats::write_text(std::ostream &os) const
+{
+    os << "Kills: " << kills() << " (per " << ticks_per_bucket << " ticks:";
+    for (uint64_t n : kill_rate(shown_buckets))
+        os << ' ' << n;
+    os << ")\n";
+    for (size_t a = DragonType; a < NpcTypeCount; ++a)
+    {
+        os << type_labels[a] << " killed";
+        for (size_t d = DragonType; d < NpcTypeCount; ++d)
+            os << (d == DragonType ? " " : ", ") << type_labels[d] << ": "
+               << kills(static_cast<NpcType>(a), static_cast<NpcType>(d));
+        os << '\n';
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "world.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Running combat statistics fed by the OnKill events of a world's bus.
+// Every kill is two relaxed atomic adds on fixed counters: the attacker x
+// defender kill matrix and the kill-rate bucket of the current tick. Every
+// query reads a fixed number of counters, so it is O(1) and may run on any
+// thread while fight workers keep publishing. Alive counts come from the
+// world's own per-type counters.
+//
+// Kill rates are kept in a ring of bucket_count buckets of ticks_per_bucket
+// ticks each. begin_tick() moves the stream to a new tick; it runs between
+// ticks, when no kills are being published.
+class KillStats
+{
+public:
+    static constexpr size_t bucket_count = 64;
+
+private:
+    World *world{nullptr};
+    uint32_t token{0};
+    uint64_t ticks_per_bucket;
+
+    alignas(64) std::atomic<uint64_t> matrix[NpcTypeCount][NpcTypeCount]{};
+    std::atomic<uint64_t> buckets[bucket_count]{};
+    std::atomic<uint64_t> current_bucket{0};
+
+    void on_kill(const OnKill &event);
+
+public:
+    explicit KillStats(uint64_t ticks_per_bucket = 10);
+    ~KillStats();
+
+    KillStats(const KillStats &) = delete;
+    KillStats &operator=(const KillStats &) = delete;
+
+    // Subscribes to the world's OnKill events. Must not run while kills are
+    // published.
+    void attach(World &world);
+    void detach();
+    void reset();
+
+    void record(NpcType attacker, NpcType defender);
+    void begin_tick(uint64_t tick);
+
+    uint64_t kills(NpcType attacker, NpcType defender) const;
+    uint64_t kills_by(NpcType attacker) const;
+    uint64_t deaths(NpcType defender) const;
+    uint64_t kills() const;
+
+    uint64_t bucket_ticks() const { return ticks_per_bucket; }
+    // Kills per bucket for the last `count` buckets (at most bucket_count),
+    // oldest first; the last entry is the bucket still being filled.
+    std::vector<uint64_t> kill_rate(size_t count) const;
+
+    void write_text(std::ostream &os) const;
+};
@@ -1,11 +1,19 @@
 #include "factory.h"
+#include "world.h"
+#include "fight_manager.h"
+#include "simulation.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "generator.h"
+#include "metrics.h"
+#include "grid_renderer.h"
+#include "kill_stats.h"
 #include <thread>
 #include <mutex>
 #include <chrono>
-#include <queue>
-#include <optional>
 #include <array>
 #include <limits>
+#include <charconv>
 
 using namespace std::chrono_literals;
 std::mutex print_mutex;
@@ -21,86 +29,54 @@ struct print : std::stringstream
     }
 };
 
-struct FightEvent
+void clear_input()
 {
-    std::shared_ptr<NPC> attacker;
-    std::shared_ptr<NPC> defender;
-};
+    std::cin.clear();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+}
 
-class FightManager
+// Parses a whole command-line value; a sign on an unsigned value, trailing
+// text or an out-of-range number fails instead of throwing.
+template <typename T>
+bool parse_number(const std::string &text, T &out)
 {
-private:
-    std::queue<FightEvent> events;
-    FightManager() {}
-    std::mutex mtx;
-    
-public:
-    static FightManager &get()
-    {
-        static FightManager instance;
-        return instance;
-    }
-
-    void add_event(FightEvent &&event)
-    {
-        std::lock_guard<std::mutex> lck(mtx);
-        events.push(event);
-    }
+    const char *end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return ec == std::errc() && ptr == end && !text.empty();
+}
 
-    void clear_events()
+// Text loads print progress and list the records that were skipped.
+void load_world_text(World& world, const std::string& filename, std::ostream& log)
+{
+    TextLoadConfig config;
+    size_t shown = 101;
+    config.progress = [&log, &filename, &shown](size_t done, size_t total)
     {
-        std::lock_guard<std::mutex> lck(mtx);
-        while (!events.empty()) {
-            events.pop();
-        }
-    }
+        const size_t percent = total ? done * 100 / total : 100;
+        if (percent == shown)
+            return;
+        shown = percent;
+        log << "\rLoading " << filename << ": " << percent << "%" << std::flush;
+    };
 
-    void operator()()
+    TextLoadResult result = load_text(world, filename, config);
+    if (!result.opened)
     {
-        while (true)
-        {
-            std::optional<FightEvent> event;
-            if (!events.empty())
-            {
-                std::lock_guard<std::mutex> lck(mtx);
-                event = events.front();
-                events.pop();
-            }
-
-            if (event)
-                if (event->attacker->is_alive())
-                    if (event->defender->is_alive())
-                    {
-                        bool attacker_wins = event->defender->accept(event->attacker);
-                        bool defender_wins = event->attacker->accept(event->defender);
-                        
-                        if (attacker_wins && defender_wins)
-                        {
-                            event->attacker->must_die();
-                            event->defender->must_die();
-                        }
-                        else if (attacker_wins)
-                        {
-                            event->defender->must_die();
-                        }
-                        else if (defender_wins)
-                        {
-                            event->attacker->must_die();
-                        }
-                    }
-            
-            std::this_thread::sleep_for(100ms);
-        }
+        log << "Cannot open " << filename << std::endl;
+        return;
     }
-};
+    if (shown <= 100)
+        log << std::endl;
+    log << "Loaded " << result.npcs.size() << " NPCs from " << filename << std::endl;
 
-void clear_input()
-{
-    std::cin.clear();
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    constexpr size_t max_listed = 10;
+    for (size_t i = 0; i < std::min(result.errors.size(), max_listed); ++i)
+        log << "Skipped line " << result.errors[i].line << ": " << result.errors[i].message << std::endl;
+    if (result.errors.size() > max_listed)
+        log << "... and " << (result.errors.size() - max_listed) << " more" << std::endl;
 }
 
-void add_npc_manual(set_t& npcs)
+void add_npc_manual(World& world, int max_x, int max_y)
 {
     std::cout << "\n=== ADD NPC ===" << std::endl;
     std::cout << "1. Dragon" << std::endl;
@@ -116,15 +92,15 @@ void add_npc_manual(set_t& npcs)
         return;
     }
     
-    std::cout << "X (0-500): ";
+    std::cout << "X (0-" << max_x << "): ";
     int x;
     std::cin >> x;
     
-    std::cout << "Y (0-500): ";
+    std::cout << "Y (0-" << max_y << "): ";
     int y;
     std::cin >> y;
     
-    if (x < 0 || x > 500 || y < 0 || y > 500)
+    if (!std::cin || x < 0 || x > max_x || y < 0 || y > max_y)
     {
         clear_input();
         return;
@@ -140,51 +116,61 @@ void add_npc_manual(set_t& npcs)
     
     if (npc)
     {
-        npcs.insert(npc);
+        world.add(npc);
         npc->print();
     }
 }
 
-void remove_npc(set_t& npcs)
+void remove_npc(World& world)
 {
     std::cout << "\n=== REMOVE NPC ===" << std::endl;
-    print_all(npcs);
+    print_all(world);
     
     std::cout << "Number: ";
     int index;
     std::cin >> index;
     
-    if (index < 1 || index > npcs.size())
+    if (index < 1 || index > world.size())
     {
         clear_input();
         return;
     }
     
-    auto it = npcs.begin();
-    std::advance(it, index - 1);
-    npcs.erase(it);
+    world.remove(world.id_at(index - 1));
     
     clear_input();
 }
 
-void start_combat_mode(set_t& npcs)
+void render_combat(GridRenderer& renderer, const World& world, const KillStats& stats, const TickScheduler& scheduler,
+                   int max_x, int max_y)
+{
+    renderer.draw(world, max_x, max_y);
+
+    const size_t alive_count = world.alive_count();
+    std::ostringstream status;
+    status << "Statistics:\n";
+    status << "Alive: " << alive_count << " (Dragons: " << world.alive_count(DragonType)
+           << ", Knights: " << world.alive_count(KnightType) << ", Elves: " << world.alive_count(ElfType) << ")\n";
+    status << "Dead: " << (world.size() - alive_count) << "\n";
+    stats.write_text(status);
+    status << "Tick: " << scheduler.ticks() << "\n";
+    scheduler.report(status);
+    status << "Queue depth: " << FightManager::get().pending() << "\n";
+    Metrics::get().snapshot().write_text(status);
+
+    renderer.present(status.str());
+}
+
+void start_combat_mode(World& world, int max_x, int max_y)
 {
-    if (npcs.empty()) {
+    if (world.empty()) {
         std::cout << "\nCannot start combat mode: no NPCs available!" << std::endl;
         std::cout << "Press Enter to continue...";
         std::cin.get();
         return;
     }
     
-    int alive_count = 0;
-    for (const auto& npc : npcs) {
-        if (npc->is_alive()) {
-            alive_count++;
-            if (alive_count >= 2) break;
-        }
-    }
-    
-    if (alive_count < 2) {
+    if (world.alive_count() < 2) {
         std::cout << "\nCannot start combat mode: need at least 2 alive NPCs!" << std::endl;
         std::cout << "Press Enter to continue...";
         std::cin.get();
@@ -203,159 +189,108 @@ void start_combat_mode(set_t& npcs)
         return;
     }
     
+    int tick_rate;
+    std::cout << "Ticks per second (0 - as fast as possible): ";
+    std::cin >> tick_rate;
+    
+    if (!std::cin || tick_rate < 0)
+    {
+        std::cout << "Tick rate must not be negative!" << std::endl;
+        clear_input();
+        return;
+    }
+    
+    int columns, rows;
+    std::cout << "Grid size, columns and rows (0 0 - " << GridRenderer::default_size << "x"
+              << GridRenderer::default_size << "): ";
+    std::cin >> columns >> rows;
+
+    if (!std::cin || columns < 0 || rows < 0)
+    {
+        std::cout << "Grid size must not be negative!" << std::endl;
+        clear_input();
+        return;
+    }
+
+    if (columns > GridRenderer::max_size || rows > GridRenderer::max_size)
+    {
+        std::cout << "Grid size must be at most " << GridRenderer::max_size << "x"
+                  << GridRenderer::max_size << "!" << std::endl;
+        clear_input();
+        return;
+    }
+    
     clear_input();
     
-    const int MAX_X = 500;
-    const int MAX_Y = 500;
-    const int DISTANCE = distance;
+    SimulationConfig config;
+    config.max_x = max_x;
+    config.max_y = max_y;
+    config.distance = distance;
+    config.seed = static_cast<uint64_t>(std::time(nullptr));
     
     FightManager::get().clear_events();
     
     std::cout << "Combat mode started! Press Enter to stop..." << std::endl;
     
-    std::thread fight_thread(std::ref(FightManager::get()));
+    Simulation simulation(world, config);
+    simulation.set_fight_manager(&FightManager::get());
+    FightManager::get().start(world, std::thread::hardware_concurrency());
     
-    bool combat_running = true;
+    TickScheduler scheduler(tick_rate);
+    auto next_frame = std::chrono::steady_clock::now();
+    GridRenderer renderer(std::min(columns ? columns : GridRenderer::default_size, config.max_x + 1),
+                          std::min(rows ? rows : GridRenderer::default_size, config.max_y + 1));
+    KillStats stats;
+    stats.attach(world);
+    size_t shown_alive = world.alive_count();
     
-    std::thread move_thread([&npcs, MAX_X, MAX_Y, DISTANCE, &combat_running]()
+    scheduler.add_phase("move", [&simulation, &stats]()
     {
-        while (combat_running)
-        {
-            for (const std::shared_ptr<NPC> & npc : npcs)
-                if(npc->is_alive())
-                    npc->move(std::rand() % 40 - 20, 
-                              std::rand() % 40 - 20, MAX_X, MAX_Y);
-
-            for (const std::shared_ptr<NPC> & npc : npcs)
-                for (const std::shared_ptr<NPC> & other : npcs) 
-                    if ((other != npc) && 
-                        (npc->is_alive()) && 
-                        (other->is_alive()) && 
-                        (npc->is_close(other, DISTANCE)))
-                        FightManager::get().add_event({npc, other});
-            
-            std::this_thread::sleep_for(10ms);
-        }
+        stats.begin_tick(simulation.ticks());
+        simulation.move_phase();
+    });
+    scheduler.add_phase("detect", [&simulation]() { simulation.detect_phase(); });
+    scheduler.add_phase("resolve", [&simulation]() { simulation.resolve_phase(); });
+    scheduler.add_phase("render", [&world, &stats, &scheduler, &next_frame, &config, &renderer, &shown_alive]()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now < next_frame)
+            return;
+        next_frame = now + 500ms;
+        // Kill reports scroll the terminal under the frame, so redraw it all.
+        if (world.alive_count() != shown_alive)
+            renderer.invalidate();
+        shown_alive = world.alive_count();
+        render_combat(renderer, world, stats, scheduler, config.max_x, config.max_y);
     });
     
-    const int grid = 20;
-    const int step_x = MAX_X / grid;
-    const int step_y = MAX_Y / grid;
-    
-    std::thread input_thread([&combat_running]() {
+    std::thread input_thread([&scheduler]() {
         std::cin.get();
-        combat_running = false;
+        scheduler.stop();
     });
     
-    while (combat_running)
-    {
-        std::array<char, grid * grid> fields{0};
-        
-        for (const std::shared_ptr<NPC> &npc : npcs)
-        {
-            const auto [x, y] = npc->position();
-            int i = x / step_x;
-            int j = y / step_y;
-            
-            if (i >= 0 && i < grid && j >= 0 && j < grid)
-            {
-                if (npc->is_alive())
-                {
-                    switch (npc->get_type())
-                    {
-                    case DragonType:
-                        fields[i + grid * j] = 'D';
-                        break;
-                    case KnightType:
-                        fields[i + grid * j] = 'K';
-                        break;
-                    case ElfType:
-                        fields[i + grid * j] = 'E';
-                        break;
-                    default:
-                        break;
-                    }
-                }
-                else
-                {
-                    fields[i + grid * j] = '.';
-                }
-            }
-        }
-        
-        std::cout << "\033[2J\033[1;1H";
-        
-        std::cout << "=== COMBAT MODE ===" << std::endl;
-        std::cout << "D - Dragon, K - Knight, E - Elf, . - dead" << std::endl;
-        std::cout << "Press Enter to stop" << std::endl << std::endl;
-        
-        for (int j = 0; j < grid; ++j)
-        {
-            for (int i = 0; i < grid; ++i)
-            {
-                char c = fields[i + j * grid];
-                if (c != 0)
-                    std::cout << "[" << c << "]";
-                else
-                    std::cout << "[ ]";
-            }
-            std::cout << std::endl;
-        }
-        
-        int alive_count = 0;
-        int dragon_count = 0;
-        int knight_count = 0;
-        int elf_count = 0;
-        
-        for (const auto& npc : npcs)
-        {
-            if (npc->is_alive())
-            {
-                alive_count++;
-                switch (npc->get_type())
-                {
-                case DragonType: dragon_count++; break;
-                case KnightType: knight_count++; break;
-                case ElfType: elf_count++; break;
-                }
-            }
-        }
-        
-        std::cout << std::endl;
-        std::cout << "Statistics:" << std::endl;
-        std::cout << "Alive: " << alive_count << " (Dragons: " << dragon_count 
-                  << ", Knights: " << knight_count << ", Elves: " << elf_count << ")" << std::endl;
-        std::cout << "Dead: " << (npcs.size() - alive_count) << std::endl;
-        
-        std::this_thread::sleep_for(500ms);
-    }
-    
+    scheduler.run();
     input_thread.join();
     
-    if (move_thread.joinable())
-        move_thread.join();
+    FightManager::get().stop();
+    stats.detach();
     
-    if (fight_thread.joinable())
-        fight_thread.detach();
+    world.drop_grid();
     
     std::cout << "\nCombat mode stopped!" << std::endl;
     
-    set_t alive_npcs;
-    for (auto& npc : npcs)
-    {
-        if (npc->is_alive())
-            alive_npcs.insert(npc);
-    }
-    npcs = std::move(alive_npcs);
+    world.remove_dead();
     
-    std::cout << "Remaining alive NPCs: " << npcs.size() << std::endl;
+    std::cout << "Remaining alive NPCs: " << world.size() << std::endl;
     std::cout << "Press Enter to continue...";
     std::cin.get();
 }
 
-void editor_mode(set_t& npcs)
+void editor_mode(World& world)
 {
     bool running = true;
+    int max_x = 500;
+    int max_y = 500;
     
     while (running)
     {
@@ -367,7 +302,8 @@ void editor_mode(set_t& npcs)
         std::cout << "5. Load from file" << std::endl;
         std::cout << "6. Start combat mode" << std::endl;
         std::cout << "7. Generate random NPCs" << std::endl;
-        std::cout << "8. Exit" << std::endl;
+        std::cout << "8. Map size (" << max_x << "x" << max_y << ")" << std::endl;
+        std::cout << "9. Exit" << std::endl;
         std::cout << "Choice: ";
         
         int choice;
@@ -377,23 +313,26 @@ void editor_mode(set_t& npcs)
         switch (choice)
         {
         case 1:
-            add_npc_manual(npcs);
+            add_npc_manual(world, max_x, max_y);
             break;
             
         case 2:
-            remove_npc(npcs);
+            remove_npc(world);
             break;
             
         case 3:
-            print_all(npcs);
+            print_all(world);
             break;
             
         case 4:
             {
                 std::string filename;
-                std::cout << "Filename: ";
+                std::cout << "Filename (*.npcw - binary snapshot): ";
                 std::getline(std::cin, filename);
-                save(npcs, filename);
+                if (has_snapshot_extension(filename))
+                    save_snapshot(world, filename);
+                else
+                    save(world, filename);
             }
             break;
             
@@ -402,34 +341,58 @@ void editor_mode(set_t& npcs)
                 std::string filename;
                 std::cout << "Filename: ";
                 std::getline(std::cin, filename);
-                npcs = load(filename);
+                if (is_snapshot_file(filename))
+                    load_snapshot(world, filename);
+                else
+                    load_world_text(world, filename, std::cout);
             }
             break;
             
         case 6:
-            start_combat_mode(npcs);
+            start_combat_mode(world, max_x, max_y);
             break;
             
         case 7:
             {
+                GeneratorConfig config;
                 std::cout << "How many NPCs to generate? ";
-                int count;
+                long long count;
                 std::cin >> count;
+                std::cout << "Distribution (1 - uniform, 2 - clustered, 3 - gaussian): ";
+                int distribution;
+                std::cin >> distribution;
                 clear_input();
-                
-                for (int i = 0; i < count && i < 100; ++i)
+
+                if (count <= 0)
                 {
-                    NpcType type = static_cast<NpcType>((std::rand() % 3) + 1);
-                    int x = std::rand() % 501;
-                    int y = std::rand() % 501;
-                    auto npc = NPCFactory::create(type, x, y);
-                    if (npc) npcs.insert(npc);
+                    std::cout << "Count must be positive!" << std::endl;
+                    break;
                 }
-                std::cout << "Generated " << std::min(count, 100) << " NPCs" << std::endl;
+                if (distribution == 2)
+                    config.distribution = Distribution::Clustered;
+                else if (distribution == 3)
+                    config.distribution = Distribution::Gaussian;
+
+                config.count = static_cast<size_t>(count);
+                config.max_x = max_x;
+                config.max_y = max_y;
+                config.seed = static_cast<uint64_t>(std::rand()) << 32 | static_cast<uint64_t>(std::rand());
+                generate(world, config);
+                std::cout << "Generated " << config.count << " NPCs" << std::endl;
             }
             break;
             
         case 8:
+            {
+                std::string size;
+                std::cout << "Map size, X or XxY (up to " << max_map_coordinate << "): ";
+                std::getline(std::cin, size);
+                if (!parse_map_size(size, max_x, max_y))
+                    std::cout << "Invalid map size!" << std::endl;
+            }
+            break;
+            
+        case 9:
             running = false;
             break;
             
@@ -440,11 +403,163 @@ void editor_mode(set_t& npcs)
     }
 }
 
-int main()
+int run_headless(int argc, char **argv)
+{
+    SimulationConfig config;
+    uint64_t ticks = 1000;
+    GeneratorConfig generator;
+    std::string load_file;
+    std::string kill_log_file;
+    std::string save_file;
+    std::string metrics_file;
+    uint64_t metrics_every = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--headless")
+            continue;
+        else if (arg == "--seed" && has_value && parse_number(argv[i + 1], config.seed))
+            ++i;
+        else if (arg == "--ticks" && has_value && parse_number(argv[i + 1], ticks))
+            ++i;
+        else if (arg == "--map" && has_value && parse_map_size(argv[i + 1], config.max_x, config.max_y))
+            ++i;
+        else if (arg == "--distance" && has_value && parse_number(argv[i + 1], config.distance))
+            ++i;
+        else if (arg == "--generate" && has_value && parse_number(argv[i + 1], generator.count))
+            ++i;
+        else if (arg == "--distribution" && has_value && parse_distribution(argv[i + 1], generator.distribution))
+            ++i;
+        else if (arg == "--ratio" && has_value && parse_ratios(argv[i + 1], generator))
+            ++i;
+        else if (arg == "--threads" && has_value && parse_number(argv[i + 1], config.threads))
+        {
+            generator.threads = config.threads;
+            ++i;
+        }
+        else if (arg == "--load" && has_value)
+            load_file = argv[++i];
+        else if (arg == "--kill-log" && has_value)
+            kill_log_file = argv[++i];
+        else if (arg == "--save" && has_value)
+            save_file = argv[++i];
+        else if (arg == "--metrics" && has_value)
+            metrics_file = argv[++i];
+        else if (arg == "--metrics-every" && has_value && parse_number(argv[i + 1], metrics_every))
+            ++i;
+        else
+        {
+            std::cerr << "Invalid argument: " << arg << (has_value ? " " + std::string(argv[i + 1]) : "") << std::endl;
+            std::cerr << "Usage: npc_simulator --headless [--seed N] [--ticks N] [--map X|XxY] [--distance D]"
+                      << " [--generate N [--distribution uniform|clustered|gaussian] [--ratio D:K:E] [--threads N]"
+                      << " | --load FILE] [--kill-log FILE] [--save FILE] [--metrics FILE [--metrics-every N]]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.distance <= 0)
+    {
+        std::cerr << "Distance must be positive!" << std::endl;
+        return 1;
+    }
+
+    World world;
+    if (!load_file.empty())
+    {
+        if (is_snapshot_file(load_file))
+        {
+            if (!load_snapshot(world, load_file))
+            {
+                std::cerr << "Cannot load snapshot: " << SnapshotFile(load_file).error_message() << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            load_world_text(world, load_file, std::cerr);
+        }
+    }
+    else
+    {
+        generator.seed = config.seed;
+        generator.max_x = config.max_x;
+        generator.max_y = config.max_y;
+        generate(world, generator);
+    }
+
+    if (!save_file.empty())
+    {
+        if (has_snapshot_extension(save_file))
+            save_snapshot(world, save_file);
+        else
+            save(world, save_file);
+    }
+    
+    const size_t initial = world.size();
+    Simulation simulation(world, config);
+
+    TickScheduler scheduler;
+    scheduler.set_max_ticks(ticks);
+    scheduler.add_phase("move", [&simulation]() { simulation.move_phase(); });
+    scheduler.add_phase("detect", [&simulation]() { simulation.detect_phase(); });
+    scheduler.add_phase("resolve", [&simulation]() { simulation.resolve_phase(); });
+
+    // One JSON object per line: every metrics_every ticks, then a final one.
+    std::ofstream metrics_os;
+    if (!metrics_file.empty())
+        metrics_os.open(metrics_file);
+    if (metrics_os.is_open() && metrics_every > 0)
+        scheduler.add_phase("metrics", [&simulation, &metrics_os, metrics_every]()
+        {
+            if (simulation.ticks() % metrics_every == 0)
+            {
+                Metrics::get().snapshot().write_json(metrics_os);
+                metrics_os << '\n';
+            }
+        });
+    
+    // max_ticks 0 means unlimited to the scheduler; here it means no ticks.
+    auto started = std::chrono::steady_clock::now();
+    if (ticks > 0)
+        scheduler.run();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    if (metrics_os.is_open())
+    {
+        Metrics::get().snapshot().write_json(metrics_os);
+        metrics_os << '\n';
+    }
+
+    if (!kill_log_file.empty())
+    {
+        std::ofstream os(kill_log_file);
+        simulation.write_kill_log(os);
+    }
+
+    std::cout << "NPCs: " << initial << std::endl;
+    std::cout << "Ticks: " << simulation.ticks() << std::endl;
+    std::cout << "Seed: " << config.seed << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s (" << (elapsed > 0 ? ticks / elapsed : 0) << " ticks/s)" << std::endl;
+    std::cout << "Kills: " << simulation.kill_log().size() << std::endl;
+    std::cout << "Alive: " << world.alive_count() << " (Dragons: " << world.alive_count(DragonType)
+              << ", Knights: " << world.alive_count(KnightType) << ", Elves: " << world.alive_count(ElfType) << ")" << std::endl;
+    std::cout << "Kill log hash: " << std::hex << simulation.kill_log_hash() << std::dec << std::endl;
+    scheduler.report(std::cout);
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1)
+        return run_headless(argc, argv);
+
     std::srand(static_cast<unsigned>(std::time(nullptr)));
     
-    set_t npcs;
+    World world;
+    TextObserver::attach(world.events());
+    KillLogObserver::attach(world.events());
     
     std::cout << "=== BULGURS BOWL ONLINE WITHOUT INTERNET ===" << std::endl;
     std::cout << "Combat rules:" << std::endl;
@@ -463,7 +578,7 @@ int main()
  //       if (npc) npcs.insert(npc);
   //  }
     
-    editor_mode(npcs);
+    editor_mode(world);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "metrics.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+    const char *const counter_names[metric_count] = {
+        "pairs_tested",
+        "events_enqueued",
+        "events_dequeued"
+    };
+
+    const char *const histogram_names[histogram_count] = {
+        "move_phase_ns",
+        "neighbour_scan_ns",
+        "fight_latency_ns",
+        "observer_dispatch_ns",
+        "queue_depth"
+    };
+
+    uint64_t bucket_limit(size_t bucket)
+    {
+        if (bucket == 0)
+            return 0;
+        if (bucket >= 64)
+            return ~0ULL;
+        return (1ULL << bucket) - 1;
+    }
+}
+
+const char *metric_name(Metric metric)
+{
+    return counter_names[static_cast<size_t>(metric)];
+}
+
+const char *metric_name(MetricHistogram histogram)
+{
+    return histogram_names[static_cast<size_t>(histogram)];
+}
+
+uint64_t HistogramSummary::percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < histogram_buckets; ++b)
+    {
+        seen += buckets[b];
+        if (seen >= rank)
+            return std::min(bucket_limit(b), max);
+    }
+    return max;
+}
+
+void MetricsSnapshot::write_text(std::ostream &os) const
+{
+    for (size_t i = 0; i < metric_count; ++i)
+        os << counter_names[i] << ": " << counters[i] << '\n';
+    for (size_t i = 0; i < histogram_count; ++i)
+    {
+        const HistogramSummary &h = histograms[i];
+        os << histogram_names[i] << ": n " << h.count << ", mean " << std::fixed << std::setprecision(0) << h.mean()
+           << ", p50 " << h.percentile(0.5) << ", p99 " << h.percentile(0.99) << ", max " << h.max << '\n';
+    }
+    os.unsetf(std::ios::floatfield);
+}
+
+void MetricsSnapshot::write_json(std::ostream &os) const
+{
+    os << "{\"counters\":{";
+    for (size_t i = 0; i < metric_count; ++i)
+        os << (i ? "," : "") << '"' << counter_names[i] << "\":" << counters[i];
+    os << "},\"histograms\":{";
+    for (size_t i = 0; i < histogram_count; ++i)
+    {
+        const HistogramSummary &h = histograms[i];
+        os << (i ? "," : "") << '"' << histogram_names[i] << "\":{\"count\":" << h.count << ",\"sum\":" << h.sum
+           << ",\"max\":" << h.max << ",\"p50\":" << h.percentile(0.5) << ",\"p90\":" << h.percentile(0.9)
+           << ",\"p99\":" << h.percentile(0.99) << '}';
+    }
+    os << "}}";
+}
+
+Metrics &Metrics::get()
+{
+    // Never destroyed: thread-local leases are released after statics go away.
+    static Metrics *instance = new Metrics;
+    return *instance;
+}
+
+std::shared_ptr<Metrics::Block> Metrics::lease()
+{
+    std::lock_guard<std::mutex> lck(blocks_mtx);
+    for (auto &block : blocks)
+    {
+        bool expected = false;
+        if (block->leased.compare_exchange_strong(expected, true))
+            return block;
+    }
+    auto block = std::make_shared<Block>();
+    block->leased.store(true);
+    blocks.push_back(block);
+    return block;
+}
+
+Metrics::Block &Metrics::local()
+{
+    struct Lease
+    {
+        std::shared_ptr<Block> block = Metrics::get().lease();
+        ~Lease() { block->leased.store(false); }
+    };
+    thread_local Lease lease;
+    return *lease.block;
+}
+
+MetricsSnapshot Metrics::snapshot() const
+{
+    MetricsSnapshot result;
+    std::lock_guard<std::mutex> lck(blocks_mtx);
+    for (auto &block : blocks)
+    {
+        for (size_t i = 0; i < metric_count; ++i)
+            result.counters[i] += block->counters[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < histogram_count; ++i)
+        {
+            const auto &from = block->histograms[i];
+            HistogramSummary &to = result.histograms[i];
+            for (size_t b = 0; b < histogram_buckets; ++b)
+                to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+            to.count += from.count.load(std::memory_order_relaxed);
+            to.sum += from.sum.load(std::memory_order_relaxed);
+            to.max = std::max(to.max, from.max.load(std::memory_order_relaxed));
+        }
+    }
+    return result;
+}
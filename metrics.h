@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Hot-path counters and histograms. Every thread records into its own
+// block with plain relaxed load/store pairs (no locked instructions);
+// snapshot() sums all blocks on demand. Blocks of exited threads are kept
+// and handed to new threads, so totals never go backwards.
+//
+// Building with NPC_METRICS=0 turns the NPC_METRIC_* macros into no-ops;
+// the snapshot API stays available and reports zeros.
+#ifndef NPC_METRICS
+#define NPC_METRICS 1
+#endif
+
+enum class Metric
+{
+    PairsTested,
+    EventsEnqueued,
+    EventsDequeued,
+    Count
+};
+
+enum class MetricHistogram
+{
+    MovePhase,
+    NeighbourScan,
+    FightLatency,
+    ObserverDispatch,
+    QueueDepth,
+    Count
+};
+
+constexpr size_t metric_count = static_cast<size_t>(Metric::Count);
+constexpr size_t histogram_count = static_cast<size_t>(MetricHistogram::Count);
+// Bucket b holds values whose highest set bit is b - 1; bucket 0 holds 0.
+constexpr size_t histogram_buckets = 65;
+
+struct HistogramSummary
+{
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+    uint64_t buckets[histogram_buckets]{};
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    // Upper bound of the bucket holding the p-th quantile, 0 < p <= 1.
+    uint64_t percentile(double p) const;
+};
+
+struct MetricsSnapshot
+{
+    uint64_t counters[metric_count]{};
+    HistogramSummary histograms[histogram_count];
+
+    uint64_t counter(Metric metric) const { return counters[static_cast<size_t>(metric)]; }
+    const HistogramSummary &histogram(MetricHistogram h) const { return histograms[static_cast<size_t>(h)]; }
+
+    void write_text(std::ostream &os) const;
+    void write_json(std::ostream &os) const;
+};
+
+const char *metric_name(Metric metric);
+const char *metric_name(MetricHistogram histogram);
+
+class Metrics
+{
+public:
+    struct Block
+    {
+        std::atomic<uint64_t> counters[metric_count]{};
+        struct
+        {
+            std::atomic<uint64_t> buckets[histogram_buckets]{};
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> max{0};
+        } histograms[histogram_count];
+        std::atomic<bool> leased{false};
+    };
+
+private:
+    mutable std::mutex blocks_mtx;
+    std::vector<std::shared_ptr<Block>> blocks;
+
+    Metrics() = default;
+
+    static void bump(std::atomic<uint64_t> &value, uint64_t n)
+    {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    static Metrics &get();
+
+    // Leases a block for the calling thread (reusing one left by an exited
+    // thread when possible).
+    std::shared_ptr<Block> lease();
+    static Block &local();
+
+    static void add(Metric metric, uint64_t n = 1)
+    {
+        bump(local().counters[static_cast<size_t>(metric)], n);
+    }
+
+    static void record(MetricHistogram histogram, uint64_t value)
+    {
+        auto &h = local().histograms[static_cast<size_t>(histogram)];
+        const size_t bucket = value ? 64 - __builtin_clzll(value) : 0;
+        bump(h.buckets[bucket], 1);
+        bump(h.count, 1);
+        bump(h.sum, value);
+        if (value > h.max.load(std::memory_order_relaxed))
+            h.max.store(value, std::memory_order_relaxed);
+    }
+
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    MetricsSnapshot snapshot() const;
+};
+
+class ScopedMetricTimer
+{
+private:
+    MetricHistogram histogram;
+    uint64_t started;
+
+public:
+    explicit ScopedMetricTimer(MetricHistogram h) : histogram(h), started(Metrics::now()) {}
+    ~ScopedMetricTimer() { Metrics::record(histogram, Metrics::now() - started); }
+};
+
+#if NPC_METRICS
+#define NPC_METRIC_ADD(metric, n) Metrics::add(Metric::metric, n)
+#define NPC_METRIC_RECORD(histogram, value) Metrics::record(MetricHistogram::histogram, value)
+#define NPC_METRIC_TIMER(histogram) ScopedMetricTimer npc_metric_timer_##histogram(MetricHistogram::histogram)
+#define NPC_METRIC_NOW() Metrics::now()
+#else
+#define NPC_METRIC_ADD(metric, n) ((void)0)
+#define NPC_METRIC_RECORD(histogram, value) ((void)0)
+#define NPC_METRIC_TIMER(histogram) ((void)0)
+#define NPC_METRIC_NOW() uint64_t(0)
+#endif
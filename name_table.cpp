@@ -0,0 +1,98 @@
+#include "name_table.h"
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+NameTable::NameTable() : slots(1024, vacant), pages(new std::atomic<std::string_view *>[max_pages]())
+{
+    intern({});
+}
+
+NameTable &NameTable::get()
+{
+    // Never destroyed: names may be read while other statics shut down.
+    static NameTable *instance = new NameTable;
+    return *instance;
+}
+
+std::string_view NameTable::store(std::string_view name)
+{
+    if (name.empty())
+        return {};
+    char *dst;
+    if (name.size() > arena_block / 4)
+    {
+        arena.emplace_back(new char[name.size()]);
+        dst = arena.back().get();
+    }
+    else
+    {
+        if (name.size() > arena_left)
+        {
+            arena.emplace_back(new char[arena_block]);
+            arena_cursor = arena.back().get();
+            arena_left = arena_block;
+        }
+        dst = arena_cursor;
+        arena_cursor += name.size();
+        arena_left -= name.size();
+    }
+    std::memcpy(dst, name.data(), name.size());
+    arena_bytes += name.size();
+    return {dst, name.size()};
+}
+
+void NameTable::grow()
+{
+    std::vector<name_id> bigger(slots.size() * 2, vacant);
+    const size_t mask = bigger.size() - 1;
+    for (name_id id = 0; id < count; ++id)
+    {
+        size_t i = std::hash<std::string_view>{}(view(id)) & mask;
+        while (bigger[i] != vacant)
+            i = (i + 1) & mask;
+        bigger[i] = id;
+    }
+    slots.swap(bigger);
+}
+
+name_id NameTable::intern(std::string_view name)
+{
+    const size_t hash = std::hash<std::string_view>{}(name);
+    std::lock_guard<std::mutex> lck(mtx);
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    for (; slots[i] != vacant; i = (i + 1) & mask)
+        if (view(slots[i]) == name)
+            return slots[i];
+
+    const name_id id = count;
+    const size_t page = id >> page_bits;
+    if (page >= max_pages)
+        throw std::length_error("name table is full");
+    if (!pages[page].load(std::memory_order_relaxed))
+    {
+        page_storage.emplace_back(new std::string_view[page_size]);
+        pages[page].store(page_storage.back().get(), std::memory_order_release);
+    }
+    pages[page].load(std::memory_order_relaxed)[id & (page_size - 1)] = store(name);
+    ++count;
+
+    if (2 * static_cast<size_t>(count) > slots.size())
+        grow();
+    else
+        slots[i] = id;
+    return id;
+}
+
+size_t NameTable::size() const
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    return count;
+}
+
+size_t NameTable::bytes() const
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    return arena_bytes;
+}
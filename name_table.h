@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+using name_id = uint32_t;
+
+// Process-wide table of interned NPC names. Each distinct string is stored
+// once in an append-only arena and identified by a 32-bit id; the views
+// handed out stay valid for the life of the process. Interning takes a
+// mutex, view() does not: entries live in fixed pages published through
+// atomics and are never moved or freed.
+class NameTable
+{
+public:
+    static constexpr name_id empty = 0;
+    static constexpr size_t page_bits = 16;
+    static constexpr size_t page_size = size_t(1) << page_bits;
+    static constexpr size_t max_pages = size_t(1) << 15;
+    static constexpr size_t arena_block = 64 * 1024;
+
+private:
+    static constexpr name_id vacant = ~name_id(0);
+
+    mutable std::mutex mtx;
+    // Open-addressing index from string to id, at most half full.
+    std::vector<name_id> slots;
+    std::unique_ptr<std::atomic<std::string_view *>[]> pages;
+    std::vector<std::unique_ptr<std::string_view[]>> page_storage;
+    std::vector<std::unique_ptr<char[]>> arena;
+    char *arena_cursor{nullptr};
+    size_t arena_left{0};
+    size_t arena_bytes{0};
+    name_id count{0};
+
+    NameTable();
+
+    std::string_view store(std::string_view name);
+    void grow();
+
+public:
+    NameTable(const NameTable &) = delete;
+    NameTable &operator=(const NameTable &) = delete;
+
+    static NameTable &get();
+
+    name_id intern(std::string_view name);
+    std::string_view view(name_id id) const
+    {
+        return pages[id >> page_bits].load(std::memory_order_acquire)[id & (page_size - 1)];
+    }
+
+    size_t size() const;
+    // Characters held by the arena.
+    size_t bytes() const;
+};
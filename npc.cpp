@@ -2,22 +2,32 @@
 #include "Dragon.h"
 #include "StrangeKnight.h"
 #include "Elf.h"
+#include "world.h"
+#include "fight_rules.h"
+#include "metrics.h"
 #include <sstream>
 
-NPC::NPC(NpcType t, int _x, int _y, const std::string& _name) : 
-    type(t), x(_x), y(_y), name(_name) 
+namespace
 {
-    if (name.empty()) {
-        static int counter = 0;
-        name = "NPC_" + std::to_string(++counter);
-    }
+    std::atomic<uint32_t> auto_names{0};
+}
+
+NPC::NPC(NpcType t, int _x, int _y, std::string_view _name) : 
+    type(t), x(_x), y(_y)
+{
+    if (_name.empty())
+        name.store(auto_name | (auto_names.fetch_add(1, std::memory_order_relaxed) + 1), std::memory_order_relaxed);
+    else
+        name.store(NameTable::get().intern(_name), std::memory_order_relaxed);
 }
 
 NPC::NPC(NpcType t, std::istream &is) : type(t)
 {
+    std::string text;
     is >> x;
     is >> y;
-    std::getline(is >> std::ws, name);
+    std::getline(is >> std::ws, text);
+    name.store(NameTable::get().intern(text), std::memory_order_relaxed);
 }
 
 void NPC::subscribe(std::shared_ptr<IFightObserver> observer)
@@ -27,24 +37,47 @@ void NPC::subscribe(std::shared_ptr<IFightObserver> observer)
 
 void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win)
 {
+    fight_notify(*defender, win);
+}
+
+void NPC::fight_notify(NPC &defender, bool win)
+{
+    NPC_METRIC_TIMER(ObserverDispatch);
+    if (world)
+    {
+        const EventBus &bus = world->events();
+        bus.publish(OnFight{*this, defender, win});
+        if (win)
+            bus.publish(OnKill{*this, defender});
+    }
+
+    if (observers.empty())
+        return;
+    const std::shared_ptr<NPC> self = shared_from_this();
+    const std::shared_ptr<NPC> other = defender.shared_from_this();
     for (auto &o : observers)
-        o->on_fight(shared_from_this(), defender, win);
+        o->on_fight(self, other, win);
 }
 
 bool NPC::is_close(const std::shared_ptr<NPC> &other, size_t distance)
 {
-    std::lock_guard<std::mutex> lck(mtx);
+    const auto [own_x, own_y] = position();
     const auto [other_x, other_y] = other->position();
-    return (std::pow(x - other_x, 2) + std::pow(y - other_y, 2)) <= std::pow(distance, 2);
+    return (std::pow(own_x - other_x, 2) + std::pow(own_y - other_y, 2)) <= std::pow(distance, 2);
 }
 
 bool NPC::fight(std::shared_ptr<NPC> other)
 {
-    bool result = can_defeat(other->get_type());
+    bool result = beats(type, other->type);
     fight_notify(other, result);
     return result;
 }
 
+bool NPC::defeats(const NPC &other) const
+{
+    return beats(type, other.type);
+}
+
 bool NPC::accept(std::shared_ptr<NPC> visitor)
 {
     return visitor->fight(shared_from_this());
@@ -57,51 +90,104 @@ NpcType NPC::get_type() const
 
 std::pair<int, int> NPC::position() const
 {
+    if (world)
+        return world->position(id);
     return {x, y};
 }
 
-void NPC::set_name(const std::string& new_name)
+void NPC::set_name(std::string_view new_name)
 {
-    name = new_name;
+    name.store(NameTable::get().intern(new_name), std::memory_order_release);
 }
 
-std::string NPC::get_name() const
+uint32_t NPC::reserve_auto_names(uint32_t count)
 {
-    return name;
+    return auto_names.fetch_add(count, std::memory_order_relaxed) + 1;
+}
+
+void NPC::set_auto_name(uint32_t n)
+{
+    name.store(auto_name | n, std::memory_order_release);
+}
+
+std::string_view NPC::get_name() const
+{
+    uint32_t current = name.load(std::memory_order_acquire);
+    if (current & auto_name)
+    {
+        const name_id id = NameTable::get().intern("NPC_" + std::to_string(current & ~auto_name));
+        // A concurrent set_name() wins over the default.
+        if (name.compare_exchange_strong(current, id, std::memory_order_acq_rel, std::memory_order_acquire))
+            current = id;
+    }
+    return NameTable::get().view(current);
 }
 
 void NPC::save(std::ostream &os)
 {
-    os << x << std::endl;
-    os << y << std::endl;
-    os << name << std::endl;
+    const auto [pos_x, pos_y] = position();
+    os << pos_x << '\n';
+    os << pos_y << '\n';
+    os << get_name() << '\n';
 }
 
 std::ostream &operator<<(std::ostream &os, NPC &npc)
 {
     os << "{type: " << npc.get_type_str() 
        << ", name: " << npc.get_name() 
-       << ", x:" << npc.x << ", y:" << npc.y 
-       << ", " << (npc.alive ? "alive" : "dead") << "}";
+       << ", x:" << npc.position().first << ", y:" << npc.position().second 
+       << ", " << (npc.is_alive() ? "alive" : "dead") << "}";
     return os;
 }
 
 void NPC::move(int shift_x, int shift_y, int max_x, int max_y)
 {
-    std::lock_guard<std::mutex> lck(mtx);
+    if (world)
+    {
+        world->move(id, shift_x, shift_y, max_x, max_y);
+        return;
+    }
+
     if ((x + shift_x >= 0) && (x + shift_x <= max_x))
         x += shift_x;
     if ((y + shift_y >= 0) && (y + shift_y <= max_y))
         y += shift_y;
 }
 
+World *NPC::get_world() const
+{
+    return world;
+}
+
+npc_id NPC::get_id() const
+{
+    return id;
+}
+
 bool NPC::is_alive() const
 {
+    if (world)
+        return world->is_alive_id(id);
     return alive;
 }
 
 void NPC::must_die()
 {
-    std::lock_guard<std::mutex> lck(mtx);
+    if (world)
+    {
+        world->kill(id);
+        return;
+    }
+
     alive = false;
+}
+
+bool NPC::try_engage()
+{
+    return !engaged.exchange(true, std::memory_order_acquire);
+}
+
+void NPC::disengage()
+{
+    engaged.store(false, std::memory_order_release);
 }
\ No newline at end of file
@@ -11,19 +11,26 @@
 #include <shared_mutex>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <atomic>
+#include <string_view>
+#include "name_table.h"
 
 struct NPC;
 struct Dragon;
 struct Knight;
 struct Elf;
+class World;
 using set_t = std::set<std::shared_ptr<NPC>>;
+using npc_id = uint32_t;
 
 enum NpcType
 {
     Unknown = 0,
     DragonType = 1,
     KnightType = 2,
-    ElfType = 3
+    ElfType = 3,
+    NpcTypeCount
 };
 
 struct IFightObserver
@@ -35,32 +42,51 @@ struct IFightObserver
 class NPC : public std::enable_shared_from_this<NPC>
 {
 private:
-    std::mutex mtx;
+    std::atomic<bool> engaged{false};
     NpcType type;
     int x{0};
     int y{0};
     bool alive{true};
-    std::string name;
+    // Interned name id, or auto_name | n for a default name "NPC_n" that
+    // is only formatted and interned when first asked for.
+    mutable std::atomic<uint32_t> name{NameTable::empty};
     std::vector<std::shared_ptr<IFightObserver>> observers;
+    World *world{nullptr};
+    npc_id id{0};
+
+    friend class World;
 
 public:
-    NPC(NpcType t, int _x, int _y, const std::string& _name);
+    static constexpr uint32_t auto_name = 1u << 31;
+
+    NPC(NpcType t, int _x, int _y, std::string_view _name);
     NPC(NpcType t, std::istream &is);
     virtual ~NPC() = default;
 
     void subscribe(std::shared_ptr<IFightObserver> observer);
     void fight_notify(const std::shared_ptr<NPC> defender, bool win);
+    // Only takes shared_ptrs when per-NPC observers are subscribed.
+    void fight_notify(NPC &defender, bool win);
     bool is_close(const std::shared_ptr<NPC> &other, size_t distance);
 
-    virtual bool fight(std::shared_ptr<NPC> other) final;
-    virtual bool accept(std::shared_ptr<NPC> visitor);
+    bool fight(std::shared_ptr<NPC> other);
+    bool defeats(const NPC &other) const;
+    bool accept(std::shared_ptr<NPC> visitor);
 
     virtual void print() = 0;
     std::pair<int, int> position() const;
     NpcType get_type() const;
     
-    void set_name(const std::string& new_name);
-    std::string get_name() const;
+    void set_name(std::string_view new_name);
+    // Takes `count` consecutive default-name numbers at once and returns
+    // the first, so bulk creators can number their NPCs by position.
+    static uint32_t reserve_auto_names(uint32_t count);
+    // Gives the NPC the default name "NPC_n", still formatted lazily.
+    void set_auto_name(uint32_t n);
+    std::string_view get_name() const;
+    // The name as stored: a NameTable id, or auto_name | n for a default
+    // name not formatted yet. Never takes the name table's lock.
+    uint32_t name_ref() const { return name.load(std::memory_order_acquire); }
 
     virtual void save(std::ostream &os);
     virtual std::string get_type_str() const = 0;
@@ -68,9 +94,11 @@ public:
     friend std::ostream &operator<<(std::ostream &os, NPC &npc);
 
     void move(int shift_x, int shift_y, int max_x, int max_y);
+    World *get_world() const;
+    npc_id get_id() const;
     bool is_alive() const;
     void must_die();
 
-protected:
-    virtual bool can_defeat(NpcType defender_type) const = 0;
+    bool try_engage();
+    void disengage();
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "npc_pool.h"
+#include <new>
+
+NpcPool &NpcPool::get()
+{
+    // Never destroyed: NPCs held by other statics may still be released
+    // during shutdown and must find their slabs alive.
+    static NpcPool *instance = new NpcPool;
+    return *instance;
+}
+
+void NpcPool::add_slab(SizeClass &sc, size_t block)
+{
+    const size_t count = slab_bytes / block;
+    std::unique_ptr<char[]> slab(new char[count * block]);
+    for (size_t i = count; i-- > 0;)
+    {
+        FreeBlock *b = reinterpret_cast<FreeBlock *>(slab.get() + i * block);
+        b->next = sc.free_list;
+        sc.free_list = b;
+    }
+    sc.slabs.push_back(std::move(slab));
+}
+
+void *NpcPool::allocate(size_t bytes, size_t alignment)
+{
+    if (bytes == 0 || bytes > max_block || alignment > granularity)
+        return ::operator new(bytes, std::align_val_t(alignment));
+
+    const size_t index = class_of(bytes);
+    SizeClass &sc = classes[index];
+    std::lock_guard<std::mutex> lck(sc.mtx);
+    if (!sc.free_list)
+        add_slab(sc, (index + 1) * granularity);
+
+    FreeBlock *b = sc.free_list;
+    sc.free_list = b->next;
+    ++sc.in_use;
+    return b;
+}
+
+void NpcPool::deallocate(void *p, size_t bytes, size_t alignment) noexcept
+{
+    if (!p)
+        return;
+    if (bytes == 0 || bytes > max_block || alignment > granularity)
+    {
+        ::operator delete(p, std::align_val_t(alignment));
+        return;
+    }
+
+    SizeClass &sc = classes[class_of(bytes)];
+    std::lock_guard<std::mutex> lck(sc.mtx);
+    FreeBlock *b = static_cast<FreeBlock *>(p);
+    b->next = sc.free_list;
+    sc.free_list = b;
+    --sc.in_use;
+}
+
+size_t NpcPool::in_use() const
+{
+    size_t result = 0;
+    for (auto &sc : classes)
+    {
+        std::lock_guard<std::mutex> lck(sc.mtx);
+        result += sc.in_use;
+    }
+    return result;
+}
+
+size_t NpcPool::slab_count() const
+{
+    size_t result = 0;
+    for (auto &sc : classes)
+    {
+        std::lock_guard<std::mutex> lck(sc.mtx);
+        result += sc.slabs.size();
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Slab allocator for NPC objects. Requests are rounded up to a 16-byte
+// size class; each class carves fixed-size blocks out of 64 KiB slabs and
+// keeps freed blocks on a free list, so creating and destroying many NPCs
+// reuses the same few slabs instead of hitting the global heap per object.
+// Requests larger than the biggest class go to operator new.
+class NpcPool
+{
+public:
+    static constexpr size_t granularity = 16;
+    static constexpr size_t max_block = 512;
+    static constexpr size_t slab_bytes = 64 * 1024;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct SizeClass
+    {
+        mutable std::mutex mtx;
+        FreeBlock *free_list{nullptr};
+        std::vector<std::unique_ptr<char[]>> slabs;
+        size_t in_use{0};
+    };
+
+    SizeClass classes[max_block / granularity];
+
+    NpcPool() = default;
+
+    static size_t class_of(size_t bytes) { return (bytes + granularity - 1) / granularity - 1; }
+    static void add_slab(SizeClass &sc, size_t block);
+
+public:
+    NpcPool(const NpcPool &) = delete;
+    NpcPool &operator=(const NpcPool &) = delete;
+
+    static NpcPool &get();
+
+    void *allocate(size_t bytes, size_t alignment);
+    void deallocate(void *p, size_t bytes, size_t alignment) noexcept;
+
+    size_t in_use() const;
+    size_t slab_count() const;
+};
+
+// Standard allocator over NpcPool, usable with std::allocate_shared so the
+// object and its control block come from one pooled block.
+template <typename T>
+struct PoolAllocator
+{
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(NpcPool::get().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        NpcPool::get().deallocate(p, n * sizeof(T), alignof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) { return false; }
+
+template <typename T, typename... Args>
+std::shared_ptr<T> make_pooled(Args &&...args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
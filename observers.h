@@ -1,5 +1,7 @@
 #pragma once
 #include "npc.h"
+#include "async_logger.h"
+#include "event_bus.h"
 #include <fstream>
 #include <mutex>
 #include <chrono>
@@ -30,6 +32,23 @@ public:
             std::cout << "----------------" << std::endl;
         }
     }
+
+    void on_kill(const OnKill &event)
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        std::cout << "\n=== KILL ===" << std::endl;
+        std::cout << "Attacker: ";
+        event.attacker.print();
+        std::cout << "Defender: ";
+        event.defender.print();
+        std::cout << "----------------" << std::endl;
+    }
+
+    static uint32_t attach(EventBus &bus)
+    {
+        auto &instance = static_cast<TextObserver &>(*get());
+        return bus.subscribe<OnKill, TextObserver, &TextObserver::on_kill>(&instance);
+    }
 };
 
 class FileObserver : public IFightObserver
@@ -76,4 +95,41 @@ public:
             }
         }
     }
+};
+
+class KillLogObserver : public IFightObserver
+{
+private:
+    AsyncKillLogger logger;
+
+    KillLogObserver() : logger("log.txt") {}
+
+public:
+    static std::shared_ptr<IFightObserver> get()
+    {
+        static KillLogObserver instance;
+        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver *) {});
+    }
+
+    static AsyncKillLogger &log()
+    {
+        return static_cast<KillLogObserver &>(*get()).logger;
+    }
+
+    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override
+    {
+        if (win)
+            logger.log_kill(*attacker, *defender);
+    }
+
+    void on_kill(const OnKill &event)
+    {
+        logger.log_kill(event.attacker, event.defender);
+    }
+
+    static uint32_t attach(EventBus &bus)
+    {
+        auto &instance = static_cast<KillLogObserver &>(*get());
+        return bus.subscribe<OnKill, KillLogObserver, &KillLogObserver::on_kill>(&instance);
+    }
 };
\ No newline at end of file
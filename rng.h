@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based randomness: every draw is a pure function of the seed and
+// a few integer coordinates (tick, NPC id, ...), so results do not depend
+// on iteration order or on how work is split between threads.
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t random_at(uint64_t seed, uint64_t a, uint64_t b = 0)
+{
+    return splitmix64(splitmix64(splitmix64(seed) ^ a) ^ b);
+}
+
+// Uniform value in [0, bound) from a 32-bit slice of a random word.
+inline uint32_t bounded(uint32_t bits, uint32_t bound)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(bits) * bound) >> 32);
+}
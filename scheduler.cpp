@@ -0,0 +1,88 @@
+#include "scheduler.h"
+#include <iomanip>
+#include <thread>
+
+TickScheduler::TickScheduler(int _ticks_per_second) : ticks_per_second(_ticks_per_second) {}
+
+void TickScheduler::add_phase(const std::string &name, std::function<void()> body)
+{
+    Phase phase;
+    phase.body = std::move(body);
+    phase.timing.name = name;
+    phases.push_back(std::move(phase));
+}
+
+void TickScheduler::set_tick_rate(int _ticks_per_second)
+{
+    ticks_per_second = _ticks_per_second;
+}
+
+void TickScheduler::set_max_ticks(uint64_t ticks)
+{
+    max_ticks = ticks;
+}
+
+void TickScheduler::tick()
+{
+    for (auto &phase : phases)
+    {
+        auto started = std::chrono::steady_clock::now();
+        phase.body();
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count();
+
+        phase.timing.last_ns = ns;
+        phase.timing.max_ns = std::max(phase.timing.max_ns, ns);
+        phase.timing.total_ns += ns;
+        phase.timing.count++;
+    }
+    tick_count++;
+}
+
+void TickScheduler::run()
+{
+    using clock = std::chrono::steady_clock;
+
+    running = true;
+    auto next = clock::now();
+    while (!stop_requested && (max_ticks == 0 || tick_count < max_ticks))
+    {
+        tick();
+
+        if (ticks_per_second <= 0)
+            continue;
+
+        const auto period = std::chrono::nanoseconds(1000000000LL / ticks_per_second);
+        next += period;
+        auto now = clock::now();
+        if (next > now)
+            std::this_thread::sleep_until(next);
+        else if (now - next > period * 4)
+            next = now;
+    }
+    running = false;
+}
+
+void TickScheduler::stop()
+{
+    stop_requested = true;
+    running = false;
+}
+
+std::vector<PhaseTiming> TickScheduler::timings() const
+{
+    std::vector<PhaseTiming> result;
+    for (auto &phase : phases)
+        result.push_back(phase.timing);
+    return result;
+}
+
+void TickScheduler::report(std::ostream &os) const
+{
+    os << std::fixed << std::setprecision(3);
+    for (auto &phase : phases)
+        os << phase.timing.name << ": last " << phase.timing.last_ns / 1e6
+           << " ms, avg " << phase.timing.average_ms()
+           << " ms, max " << phase.timing.max_ns / 1e6 << " ms" << std::endl;
+    os << std::defaultfloat;
+}
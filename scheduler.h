@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct PhaseTiming
+{
+    std::string name;
+    uint64_t last_ns{0};
+    uint64_t max_ns{0};
+    uint64_t total_ns{0};
+    uint64_t count{0};
+
+    double average_ms() const { return count ? total_ns / 1e6 / count : 0.0; }
+};
+
+// Runs a fixed list of phases once per tick, in order. A phase starts only
+// after the previous one has returned, so every phase acts as a barrier for
+// the next. With a tick rate the loop keeps a fixed timestep (dropping
+// ticks it cannot catch up on); with rate 0 it runs as fast as possible.
+class TickScheduler
+{
+private:
+    struct Phase
+    {
+        std::function<void()> body;
+        PhaseTiming timing;
+    };
+
+    std::vector<Phase> phases;
+    int ticks_per_second;
+    std::atomic<bool> running{false};
+    // Set by stop() and never cleared, so a stop that comes before run()
+    // still ends it.
+    std::atomic<bool> stop_requested{false};
+    std::atomic<uint64_t> tick_count{0};
+    uint64_t max_ticks{0};
+
+public:
+    explicit TickScheduler(int ticks_per_second = 0);
+
+    void add_phase(const std::string &name, std::function<void()> body);
+    void set_tick_rate(int ticks_per_second);
+    void set_max_ticks(uint64_t ticks);
+
+    void tick();
+    void run();
+    void stop();
+
+    bool is_running() const { return running.load(); }
+    uint64_t ticks() const { return tick_count.load(); }
+    std::vector<PhaseTiming> timings() const;
+    void report(std::ostream &os) const;
+};
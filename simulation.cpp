@@ -0,0 +1,400 @@
+#include "simulation.h"
+#include "rng.h"
+#include "fight_rules.h"
+#include "metrics.h"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    // A detect tile is 2^tile_bits x 2^tile_bits grid cells.
+    constexpr int tile_bits = 3;
+    // NPCs per detect task and per move block.
+    constexpr size_t min_tile_task = 8;
+    constexpr size_t max_tile_task = 256;
+    constexpr size_t move_block = 4096;
+    constexpr size_t bucket_npcs = 16;
+    constexpr size_t min_scan_window = 16;
+}
+
+Simulation::Simulation(World &_world, const SimulationConfig &_config) : world(_world), config(_config)
+{
+    world.compact();
+    world.build_grid(config.distance);
+    const size_t threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1)
+    {
+        pool = std::make_unique<TilePool>(threads);
+        scratch.resize(pool->workers());
+    }
+    scan_window = min_scan_window;
+}
+
+void Simulation::set_fight_manager(FightManager *manager)
+{
+    fight_manager = manager;
+}
+
+void Simulation::move_phase()
+{
+    NPC_METRIC_TIMER(MovePhase);
+    world.begin_moves();
+    const size_t blocks = (world.live_end() + move_block - 1) / move_block;
+    if (pool && blocks > 1)
+        pool->run(blocks, [this](size_t block, size_t)
+        {
+            move_range(block * move_block, std::min(world.live_end(), (block + 1) * move_block));
+        });
+    else
+        move_range(0, world.live_end());
+    world.commit_moves();
+}
+
+void Simulation::move_range(size_t begin, size_t end)
+{
+    const uint32_t span = static_cast<uint32_t>(config.step) * 2;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (!world.is_alive(i))
+            continue;
+        const uint64_t r = random_at(config.seed, tick_count, world.id_at(i));
+        const int shift_x = static_cast<int>(bounded(static_cast<uint32_t>(r), span)) - config.step;
+        const int shift_y = static_cast<int>(bounded(static_cast<uint32_t>(r >> 32), span)) - config.step;
+        world.stage_move(i, shift_x, shift_y, config.max_x, config.max_y);
+    }
+}
+
+void Simulation::detect_phase()
+{
+    pairs.clear();
+    next_contacts.clear();
+    pruned_contacts = 0;
+    scan_cursor = 0;
+    collect_pairs();
+}
+
+// Calls emit(key, j, fresh) for every live neighbour j above i that can
+// fight it; fresh pairs were not in contact last tick.
+template <typename F>
+void Simulation::scan_neighbours(size_t i, bool keep_harmless, size_t &tested, F &&emit) const
+{
+    const uint64_t own = world.id_at(i);
+    const NpcType own_type = world.type(i);
+    world.for_each_neighbour(i, config.distance, [this, i, own, own_type, keep_harmless, &tested, &emit](size_t j)
+    {
+        if ((j <= i) || !world.is_alive(j))
+            return;
+        ++tested;
+        if (!keep_harmless && fight_outcome(own_type, world.type(j)) == 0)
+            return;
+        const uint64_t other = world.id_at(j);
+        const uint64_t key = own < other ? (own << 32 | other) : (other << 32 | own);
+        emit(key, j, !std::binary_search(contacts.begin(), contacts.end(), key));
+    });
+}
+
+void Simulation::collect_pairs()
+{
+    if (pool)
+    {
+        collect_pairs_tiled();
+        return;
+    }
+    NPC_METRIC_TIMER(NeighbourScan);
+    const bool keep_harmless = world.events().has_subscribers<OnFight>();
+    size_t tested = 0;
+    while (scan_cursor < world.live_end() && pairs.size() < config.max_pairs)
+    {
+        const size_t i = scan_cursor++;
+        if (!world.is_alive(i))
+            continue;
+        scan_neighbours(i, keep_harmless, tested, [this, i](uint64_t key, size_t j, bool fresh)
+        {
+            next_contacts.push_back(key);
+            if (fresh)
+                pairs.emplace_back(static_cast<uint32_t>(i), static_cast<uint32_t>(j));
+        });
+    }
+    NPC_METRIC_ADD(PairsTested, tested);
+}
+
+// Scans a window of NPC indices at a time. The window's NPCs are grouped by
+// tile so a task walks a compact patch of the grid, and the tasks run on
+// the pool. Their output is then joined in index order up to the NPC at
+// which the serial scan would have filled the batch; anything found past it
+// is dropped and scanned again in the next batch.
+void Simulation::collect_pairs_tiled()
+{
+    NPC_METRIC_TIMER(NeighbourScan);
+    const bool keep_harmless = world.events().has_subscribers<OnFight>();
+    size_t tested = 0;
+    while (scan_cursor < world.live_end() && pairs.size() < config.max_pairs)
+    {
+        const size_t lo = scan_cursor;
+        const size_t hi = std::min(world.live_end(), lo + scan_window);
+        // Counting sort into row-major tile buckets; neighbouring tiles of a
+        // row land in neighbouring buckets, so a task covers a strip.
+        const uint64_t tiles_per_row = (static_cast<uint64_t>(config.max_x / config.distance) >> tile_bits) + 1;
+        size_t buckets = 1;
+        while (buckets * bucket_npcs < hi - lo)
+            buckets *= 2;
+        bucket_ends.assign(buckets + 1, 0);
+        member_buckets.resize(hi - lo);
+        for (size_t i = lo; i < hi; ++i)
+        {
+            uint32_t bucket = static_cast<uint32_t>(buckets);
+            if (world.is_alive(i))
+            {
+                const uint64_t tx = static_cast<uint64_t>(world.x(i) / config.distance) >> tile_bits;
+                const uint64_t ty = static_cast<uint64_t>(world.y(i) / config.distance) >> tile_bits;
+                bucket = static_cast<uint32_t>((ty * tiles_per_row + tx) & (buckets - 1));
+            }
+            member_buckets[i - lo] = bucket;
+            ++bucket_ends[bucket];
+        }
+        for (size_t b = 1; b <= buckets; ++b)
+            bucket_ends[b] += bucket_ends[b - 1];
+        tile_members.resize(bucket_ends[buckets - 1]);
+        for (size_t i = hi; i-- > lo;)
+        {
+            const uint32_t bucket = member_buckets[i - lo];
+            if (bucket < buckets)
+                tile_members[--bucket_ends[bucket]] = static_cast<uint32_t>(i);
+        }
+        const size_t task_size = std::clamp(tile_members.size() / (4 * pool->workers()), min_tile_task, max_tile_task);
+        tile_tasks.clear();
+        for (size_t begin = 0; begin < tile_members.size(); begin += task_size)
+            tile_tasks.emplace_back(begin, std::min(tile_members.size(), begin + task_size));
+
+        for (auto &out : scratch)
+        {
+            out.pairs.clear();
+            out.contacts.clear();
+        }
+        spans.assign(hi - lo, ScanSpan{});
+        pool->run(tile_tasks.size(), [this, lo, keep_harmless](size_t task, size_t worker)
+        {
+            TileScratch &out = scratch[worker];
+            for (size_t m = tile_tasks[task].first; m < tile_tasks[task].second; ++m)
+            {
+                const size_t i = tile_members[m];
+                ScanSpan &span = spans[i - lo];
+                span.worker = static_cast<uint32_t>(worker);
+                span.pair_begin = static_cast<uint32_t>(out.pairs.size());
+                span.contact_begin = static_cast<uint32_t>(out.contacts.size());
+                scan_neighbours(i, keep_harmless, out.tested, [&out, i](uint64_t key, size_t j, bool fresh)
+                {
+                    out.contacts.push_back(key);
+                    if (fresh)
+                        out.pairs.emplace_back(static_cast<uint32_t>(i), static_cast<uint32_t>(j));
+                });
+                span.pair_end = static_cast<uint32_t>(out.pairs.size());
+                span.contact_end = static_cast<uint32_t>(out.contacts.size());
+            }
+        });
+
+        const size_t found_before = pairs.size();
+        scan_cursor = hi;
+        for (size_t i = lo; i < hi; ++i)
+        {
+            const ScanSpan &span = spans[i - lo];
+            const TileScratch &in = scratch[span.worker];
+            pairs.insert(pairs.end(), in.pairs.begin() + span.pair_begin, in.pairs.begin() + span.pair_end);
+            if (pairs.size() >= config.max_pairs)
+            {
+                scan_cursor = i + 1;
+                break;
+            }
+        }
+        // Contact order does not matter, they are sorted at the end of the tick.
+        if (scan_cursor == hi)
+            for (const auto &in : scratch)
+                next_contacts.insert(next_contacts.end(), in.contacts.begin(), in.contacts.end());
+        else
+            for (size_t i = lo; i < scan_cursor; ++i)
+            {
+                const ScanSpan &span = spans[i - lo];
+                const TileScratch &in = scratch[span.worker];
+                next_contacts.insert(next_contacts.end(), in.contacts.begin() + span.contact_begin, in.contacts.begin() + span.contact_end);
+            }
+
+        if (scan_cursor < hi)
+            scan_window = std::max(min_scan_window, scan_cursor - lo);
+        else if (2 * (pairs.size() - found_before) < config.max_pairs)
+            scan_window = std::min(2 * scan_window, std::max(world.live_end(), min_scan_window));
+    }
+    for (auto &out : scratch)
+    {
+        tested += out.tested;
+        out.tested = 0;
+    }
+    NPC_METRIC_ADD(PairsTested, tested);
+}
+
+// NPCs killed by the last batch leave the grid, so the rest of the scan
+// does not keep walking over them in crowded cells.
+void Simulation::unindex_dead()
+{
+    dead.clear();
+    for (const auto &[a, d] : pairs)
+    {
+        if (!world.is_alive(a))
+            dead.push_back(world.id_at(a));
+        if (!world.is_alive(d))
+            dead.push_back(world.id_at(d));
+    }
+    std::sort(dead.begin(), dead.end());
+    dead.erase(std::unique(dead.begin(), dead.end()), dead.end());
+    for (npc_id id : dead)
+        world.unindex(id);
+}
+
+// Contacts with a dead NPC can never fight again.
+void Simulation::prune_contacts()
+{
+    next_contacts.erase(std::remove_if(next_contacts.begin(), next_contacts.end(), [this](uint64_t key)
+    {
+        return !world.is_alive_id(static_cast<npc_id>(key >> 32)) || !world.is_alive_id(static_cast<npc_id>(key));
+    }), next_contacts.end());
+    pruned_contacts = next_contacts.size();
+}
+
+void Simulation::resolve_phase()
+{
+    while (true)
+    {
+        resolve_pairs();
+        unindex_dead();
+        pairs.clear();
+        if (scan_cursor >= world.live_end())
+            break;
+        if (next_contacts.size() > 2 * pruned_contacts + config.max_pairs)
+            prune_contacts();
+        collect_pairs();
+    }
+
+    prune_contacts();
+    std::sort(next_contacts.begin(), next_contacts.end());
+    contacts.swap(next_contacts);
+    world.compact();
+    ++tick_count;
+}
+
+void Simulation::resolve_pairs()
+{
+    if (fight_manager)
+    {
+        for (const auto &[a, d] : pairs)
+            while (!fight_manager->add_event({world.handle_at(a), world.handle_at(d)}))
+                std::this_thread::yield();
+        fight_manager->wait_idle();
+        return;
+    }
+
+    // Types never change during a tick, so every outcome is known up front;
+    // only the alive checks below depend on the order pairs are resolved in.
+    attacker_types.resize(pairs.size());
+    defender_types.resize(pairs.size());
+    outcomes.resize(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        attacker_types[i] = world.type(pairs[i].first);
+        defender_types[i] = world.type(pairs[i].second);
+    }
+    fight_outcomes(attacker_types.data(), defender_types.data(), outcomes.data(), pairs.size());
+
+    const EventBus &bus = world.events();
+    const bool notify_fights = bus.has_subscribers<OnFight>();
+    const bool notify_kills = bus.has_subscribers<OnKill>();
+
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        const auto [a, d] = pairs[i];
+        if (!world.is_alive(a) || !world.is_alive(d))
+            continue;
+
+        NPC &attacker = *world.object(a);
+        NPC &defender = *world.object(d);
+        const bool attacker_wins = outcomes[i] & 1;
+        const bool defender_wins = outcomes[i] & 2;
+
+        if (notify_fights || notify_kills)
+        {
+            NPC_METRIC_TIMER(ObserverDispatch);
+            if (notify_fights)
+            {
+                bus.publish(OnFight{attacker, defender, attacker_wins});
+                bus.publish(OnFight{defender, attacker, defender_wins});
+            }
+            if (notify_kills)
+            {
+                if (attacker_wins)
+                    bus.publish(OnKill{attacker, defender});
+                if (defender_wins)
+                    bus.publish(OnKill{defender, attacker});
+            }
+        }
+
+        if (attacker_wins)
+        {
+            kills.push_back({tick_count, world.id_at(a), world.id_at(d)});
+            world.kill(world.id_at(d));
+        }
+        if (defender_wins)
+        {
+            kills.push_back({tick_count, world.id_at(d), world.id_at(a)});
+            world.kill(world.id_at(a));
+        }
+    }
+}
+
+void Simulation::tick()
+{
+    move_phase();
+    detect_phase();
+    resolve_phase();
+}
+
+void Simulation::run(uint64_t ticks)
+{
+    for (uint64_t i = 0; i < ticks; ++i)
+        tick();
+}
+
+void Simulation::write_kill_log(std::ostream &os) const
+{
+    for (const auto &kill : kills)
+        os << kill.tick << ' ' << kill.attacker << ' ' << kill.defender << '\n';
+}
+
+uint64_t Simulation::kill_log_hash() const
+{
+    uint64_t hash = 0;
+    for (const auto &kill : kills)
+        hash = splitmix64(hash ^ random_at(kill.tick, kill.attacker, kill.defender));
+    return hash;
+}
+
+bool parse_map_size(const std::string &text, int &max_x, int &max_y)
+{
+    std::istringstream is(text);
+    long long x = 0;
+    long long y = 0;
+    char separator = 0;
+    if (!(is >> x))
+        return false;
+    if (is >> separator)
+    {
+        if (separator != 'x' || !(is >> y))
+            return false;
+    }
+    else
+        y = x;
+    if (!is.eof() && is.peek() != EOF)
+        return false;
+    if (x < 1 || y < 1 || x > max_map_coordinate || y > max_map_coordinate)
+        return false;
+    max_x = static_cast<int>(x);
+    max_y = static_cast<int>(y);
+    return true;
+}
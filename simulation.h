@@ -0,0 +1,140 @@
+#pragma once
+
+#include "world.h"
+#include "fight_manager.h"
+#include "tile_pool.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Largest coordinate a map may have; keeps a position plus a step
+// within int.
+constexpr int max_map_coordinate = 1 << 30;
+
+struct SimulationConfig
+{
+    // Coordinates run from 0 to max_x / max_y inclusive. The spatial grid
+    // only allocates where NPCs are, so these cost nothing by themselves.
+    int max_x{500};
+    int max_y{500};
+    int distance{30};
+    int step{20};
+    uint64_t seed{0};
+    // Pairs collected before they are resolved; bounds pair memory per tick.
+    size_t max_pairs{1 << 16};
+    // Threads for the move and detect phases, the caller included; 0 picks
+    // std::thread::hardware_concurrency(). Results do not depend on it.
+    size_t threads{0};
+};
+
+struct KillRecord
+{
+    uint64_t tick;
+    npc_id attacker;
+    npc_id defender;
+};
+
+// Seeded combat simulation over a World. One tick moves every alive NPC,
+// collects close pairs and resolves them. Without a fight manager pairs
+// are resolved in a fixed order on the calling thread, so two runs with the
+// same seed and world produce the same kills; with one they are handed to
+// its worker pool and the resolve phase waits until the pool is idle.
+//
+// Each unordered pair is collected once, and only on the tick it comes
+// into range: pairs already in contact on the previous tick have fought
+// and, since outcomes depend only on the kinds, would just fight to the
+// same result again. Pairs that cannot kill (two knights, two elves) are
+// skipped entirely unless someone subscribed to OnFight on the world bus,
+// so a dense same-kind cluster adds nothing to the pair list or the cache.
+//
+// The detect phase stops after config.max_pairs pairs; the resolve phase
+// resolves them and keeps scanning and resolving in batches of that size,
+// dropping the NPCs each batch killed from the grid. Results stay
+// deterministic for a given seed and max_pairs. Every tick ends with
+// World::compact(), so the next one only walks the NPCs still alive.
+//
+// With more than one thread the move phase is split into blocks of
+// indices and the detect phase into spatial tiles, both run on a
+// work-stealing TilePool. A tile scans the shared grid, so pairs that
+// straddle two tiles are found by the tile holding the lower index. Every
+// NPC's pairs are kept apart and joined in index order, and a batch is cut
+// at the same NPC the serial scan would stop at, so the kills are the same
+// for any number of threads.
+class Simulation
+{
+private:
+    World &world;
+    SimulationConfig config;
+    uint64_t tick_count{0};
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    // Sorted (min id, max id) keys of the pairs in range last tick / this tick.
+    std::vector<uint64_t> contacts;
+    std::vector<uint64_t> next_contacts;
+    size_t pruned_contacts{0};
+    size_t scan_cursor{0};
+    std::vector<npc_id> dead;
+    std::vector<NpcType> attacker_types;
+    std::vector<NpcType> defender_types;
+    std::vector<uint8_t> outcomes;
+    std::vector<KillRecord> kills;
+    FightManager *fight_manager{nullptr};
+
+    struct alignas(64) TileScratch
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        std::vector<uint64_t> contacts;
+        size_t tested{0};
+    };
+    // Where one NPC's pairs and contacts went in its worker's scratch.
+    struct ScanSpan
+    {
+        uint32_t worker;
+        uint32_t pair_begin;
+        uint32_t pair_end;
+        uint32_t contact_begin;
+        uint32_t contact_end;
+    };
+
+    std::unique_ptr<TilePool> pool;
+    std::vector<TileScratch> scratch;
+    // The current scan window's NPCs grouped by tile bucket, and the bucket
+    // of each one.
+    std::vector<uint32_t> tile_members;
+    std::vector<uint32_t> member_buckets;
+    std::vector<size_t> bucket_ends;
+    std::vector<std::pair<size_t, size_t>> tile_tasks;
+    std::vector<ScanSpan> spans;
+    // NPC indices scanned per window; adapts so a window yields about
+    // max_pairs pairs.
+    size_t scan_window{0};
+
+    void move_range(size_t begin, size_t end);
+    template <typename F>
+    void scan_neighbours(size_t i, bool keep_harmless, size_t &tested, F &&emit) const;
+    void collect_pairs();
+    void collect_pairs_tiled();
+    void resolve_pairs();
+    void prune_contacts();
+    void unindex_dead();
+
+public:
+    Simulation(World &world, const SimulationConfig &config);
+
+    void set_fight_manager(FightManager *manager);
+
+    void move_phase();
+    void detect_phase();
+    void resolve_phase();
+    void tick();
+    void run(uint64_t ticks);
+
+    uint64_t ticks() const { return tick_count; }
+    size_t pending_pairs() const { return pairs.size(); }
+    size_t contact_count() const { return contacts.size(); }
+    const std::vector<KillRecord> &kill_log() const { return kills; }
+    void write_kill_log(std::ostream &os) const;
+    uint64_t kill_log_hash() const;
+};
+
+// "X" for a square map or "XxY", each 1..max_map_coordinate.
+bool parse_map_size(const std::string &text, int &max_x, int &max_y);
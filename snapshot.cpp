@@ -0,0 +1,182 @@
+#include "snapshot.h"
+#include "factory.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t header_checksum(const SnapshotHeader &header)
+{
+    return fnv1a(&header, offsetof(SnapshotHeader, data_checksum));
+}
+
+SnapshotFile::SnapshotFile(const std::string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + filename;
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        error = "file too small";
+        return;
+    }
+
+    mapping_size = st.st_size;
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        error = "mmap failed";
+        return;
+    }
+
+    const auto *base = static_cast<const char *>(mapping);
+    const auto *candidate = reinterpret_cast<const SnapshotHeader *>(base);
+
+    if (std::memcmp(candidate->magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        error = "bad magic";
+        return;
+    }
+    if (candidate->version != snapshot_version)
+    {
+        error = "unsupported version";
+        return;
+    }
+    if (candidate->header_checksum != header_checksum(*candidate))
+    {
+        error = "header checksum mismatch";
+        return;
+    }
+
+    const uint64_t records_size = candidate->record_count * sizeof(SnapshotRecord);
+    if (candidate->record_count > mapping_size / sizeof(SnapshotRecord) ||
+        candidate->strings_size > mapping_size ||
+        sizeof(SnapshotHeader) + records_size + candidate->strings_size != mapping_size)
+    {
+        error = "truncated file";
+        return;
+    }
+
+    const char *data = base + sizeof(SnapshotHeader);
+    if (fnv1a(data, records_size + candidate->strings_size) != candidate->data_checksum)
+    {
+        error = "data checksum mismatch";
+        return;
+    }
+
+    records = reinterpret_cast<const SnapshotRecord *>(data);
+    strings = data + records_size;
+    for (uint64_t i = 0; i < candidate->record_count; ++i)
+        if (records[i].name_offset > candidate->strings_size ||
+            records[i].name_length > candidate->strings_size - records[i].name_offset)
+        {
+            error = "name out of range";
+            return;
+        }
+
+    header = candidate;
+}
+
+SnapshotFile::~SnapshotFile()
+{
+    if (mapping)
+        ::munmap(mapping, mapping_size);
+}
+
+std::string_view SnapshotFile::name(size_t index) const
+{
+    return std::string_view(strings + records[index].name_offset, records[index].name_length);
+}
+
+bool save_snapshot(const World &world, const std::string &filename)
+{
+    std::vector<SnapshotRecord> records(world.size());
+    std::string strings;
+    for (size_t i = 0; i < world.size(); ++i)
+    {
+        const std::string_view name = world.object(i)->get_name();
+        SnapshotRecord &record = records[i];
+        record.x = world.x(i);
+        record.y = world.y(i);
+        record.type = static_cast<uint8_t>(world.type(i));
+        record.alive = world.is_alive(i) ? 1 : 0;
+        record.reserved = 0;
+        record.name_length = static_cast<uint32_t>(name.size());
+        record.name_offset = strings.size();
+        strings += name;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = snapshot_version;
+    header.record_count = records.size();
+    header.strings_size = strings.size();
+    header.data_checksum = fnv1a(records.data(), records.size() * sizeof(SnapshotRecord));
+    header.data_checksum = fnv1a(strings.data(), strings.size(), header.data_checksum);
+    header.header_checksum = header_checksum(header);
+
+    std::ofstream fs(filename, std::ios::binary);
+    if (!fs.is_open())
+        return false;
+    fs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    fs.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SnapshotRecord));
+    fs.write(strings.data(), strings.size());
+    return static_cast<bool>(fs);
+}
+
+bool load_snapshot(World &world, const std::string &filename)
+{
+    SnapshotFile file(filename);
+    if (!file.valid())
+        return false;
+
+    world.clear();
+    world.reserve(file.size());
+    for (size_t i = 0; i < file.size(); ++i)
+    {
+        const SnapshotRecord &record = file.record(i);
+        auto npc = NPCFactory::create(static_cast<NpcType>(record.type), record.x, record.y,
+                                      file.name(i));
+        if (!npc)
+            continue;
+        if (!record.alive)
+            npc->must_die();
+        world.add(npc);
+    }
+    return true;
+}
+
+bool is_snapshot_file(const std::string &filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(snapshot_magic)]{};
+    is.read(magic, sizeof(magic));
+    return is && std::memcmp(magic, snapshot_magic, sizeof(snapshot_magic)) == 0;
+}
+
+bool has_snapshot_extension(const std::string &filename)
+{
+    const std::string extension = ".npcw";
+    return filename.size() > extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "world.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Binary world snapshot, native byte order:
+//
+//   SnapshotHeader
+//   SnapshotRecord[record_count]
+//   char strings[strings_size]     names, not null-terminated
+//
+// header_checksum covers the header up to the checksum fields,
+// data_checksum covers records and string table (FNV-1a 64).
+constexpr char snapshot_magic[4] = {'N', 'P', 'C', 'W'};
+constexpr uint32_t snapshot_version = 1;
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t record_count;
+    uint64_t strings_size;
+    uint64_t data_checksum;
+    uint64_t header_checksum;
+};
+
+struct SnapshotRecord
+{
+    int32_t x;
+    int32_t y;
+    uint8_t type;
+    uint8_t alive;
+    uint16_t reserved;
+    uint32_t name_length;
+    uint64_t name_offset;
+};
+
+static_assert(sizeof(SnapshotHeader) == 40, "snapshot header layout");
+static_assert(sizeof(SnapshotRecord) == 24, "snapshot record layout");
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL);
+
+// Read-only memory-mapped view of a snapshot file. Records and names are
+// read straight from the mapping.
+class SnapshotFile
+{
+private:
+    void *mapping{nullptr};
+    size_t mapping_size{0};
+    const SnapshotHeader *header{nullptr};
+    const SnapshotRecord *records{nullptr};
+    const char *strings{nullptr};
+    std::string error;
+
+public:
+    explicit SnapshotFile(const std::string &filename);
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile &) = delete;
+    SnapshotFile &operator=(const SnapshotFile &) = delete;
+
+    bool valid() const { return header != nullptr; }
+    const std::string &error_message() const { return error; }
+
+    size_t size() const { return valid() ? header->record_count : 0; }
+    const SnapshotRecord &record(size_t index) const { return records[index]; }
+    std::string_view name(size_t index) const;
+};
+
+bool save_snapshot(const World &world, const std::string &filename);
+bool load_snapshot(World &world, const std::string &filename);
+bool is_snapshot_file(const std::string &filename);
+bool has_snapshot_extension(const std::string &filename);
@@ -0,0 +1,232 @@
+#include "spatial_grid.h"
+#include <limits>
+
+SpatialGrid::SpatialGrid(int _cell_size) : cell_size(std::max(1, _cell_size))
+{
+    rehash(16);
+}
+
+size_t SpatialGrid::Cell::find(uint32_t key) const
+{
+    const uint32_t *k = keys();
+    return std::find(k, k + count, key) - k;
+}
+
+void SpatialGrid::Cell::push(uint32_t key, int x, int y)
+{
+    if (count == capacity)
+    {
+        const uint32_t grown = std::max<uint32_t>(4, capacity * 2);
+        std::unique_ptr<int[]> next(new int[3 * static_cast<size_t>(grown)]);
+        std::copy(data.get(), data.get() + count, next.get());
+        std::copy(xs(), xs() + count, next.get() + grown);
+        std::copy(ys(), ys() + count, next.get() + 2 * grown);
+        data = std::move(next);
+        capacity = grown;
+    }
+    keys()[count] = key;
+    xs()[count] = x;
+    ys()[count] = y;
+    ++count;
+}
+
+void SpatialGrid::Cell::erase(size_t index)
+{
+    --count;
+    keys()[index] = keys()[count];
+    xs()[index] = xs()[count];
+    ys()[index] = ys()[count];
+}
+
+size_t SpatialGrid::probe(uint64_t key) const
+{
+    const size_t mask = slots.size() - 1;
+    size_t i = home_slot(key, mask);
+    while (slots[i].chunk && slots[i].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void SpatialGrid::rehash(size_t capacity)
+{
+    std::vector<Slot> old(capacity);
+    old.swap(slots);
+    for (auto &slot : old)
+        if (slot.chunk)
+            slots[probe(slot.key)] = std::move(slot);
+}
+
+SpatialGrid::Chunk &SpatialGrid::chunk_for(int ci, int cj)
+{
+    if (Chunk *found = find_chunk(ci, cj))
+        return *found;
+    const uint64_t key = chunk_key(ci, cj);
+    size_t i = probe(key);
+
+    if (2 * (chunk_total + 1) > slots.size())
+    {
+        rehash(slots.size() * 2);
+        i = probe(key);
+    }
+    if (spare.empty())
+        slots[i].chunk = std::make_unique<Chunk>();
+    else
+    {
+        slots[i].chunk = std::move(spare.back());
+        spare.pop_back();
+    }
+    slots[i].key = key;
+    ++chunk_total;
+
+    Chunk &chunk = *slots[i].chunk;
+    const unsigned di = static_cast<unsigned>(ci - dir_ci);
+    const unsigned dj = static_cast<unsigned>(cj - dir_cj);
+    if (!directory.empty() && di < static_cast<unsigned>(dir_w) && dj < static_cast<unsigned>(dir_h))
+        directory[di + dj * dir_w] = &chunk;
+    else if (!directory.empty() || (chunk_total & (chunk_total - 1)) == 0)
+        rebuild_directory();
+    return chunk;
+}
+
+// Lays a directory over the chunks' bounding box, widened by an eighth on
+// each side, if the box is at most directory_slack times the chunk count.
+void SpatialGrid::rebuild_directory()
+{
+    directory.clear();
+    if (chunk_total == 0)
+        return;
+    long long ci0 = std::numeric_limits<int>::max(), cj0 = ci0;
+    long long ci1 = std::numeric_limits<int>::min(), cj1 = ci1;
+    for (const auto &slot : slots)
+        if (slot.chunk)
+        {
+            const long long ci = static_cast<int32_t>(slot.key >> 32);
+            const long long cj = static_cast<int32_t>(slot.key);
+            ci0 = std::min(ci0, ci);
+            ci1 = std::max(ci1, ci);
+            cj0 = std::min(cj0, cj);
+            cj1 = std::max(cj1, cj);
+        }
+    if ((ci1 - ci0 + 1) * (cj1 - cj0 + 1) > static_cast<long long>(directory_slack * chunk_total + directory_min))
+        return;
+
+    const long long margin_i = (ci1 - ci0) / 8 + 1;
+    const long long margin_j = (cj1 - cj0) / 8 + 1;
+    ci0 = std::max<long long>(ci0 - margin_i, std::numeric_limits<int>::min());
+    cj0 = std::max<long long>(cj0 - margin_j, std::numeric_limits<int>::min());
+    const long long w = std::min<long long>(ci1 + margin_i, std::numeric_limits<int>::max()) - ci0 + 1;
+    const long long h = std::min<long long>(cj1 + margin_j, std::numeric_limits<int>::max()) - cj0 + 1;
+
+    dir_ci = static_cast<int>(ci0);
+    dir_cj = static_cast<int>(cj0);
+    dir_w = static_cast<int>(w);
+    dir_h = static_cast<int>(h);
+    directory.assign(static_cast<size_t>(w * h), nullptr);
+    for (auto &slot : slots)
+        if (slot.chunk)
+            directory[(static_cast<int32_t>(slot.key >> 32) - dir_ci) + (static_cast<int32_t>(slot.key) - dir_cj) * static_cast<size_t>(dir_w)] = slot.chunk.get();
+}
+
+// Backward-shift deletion keeps every probe chain unbroken.
+void SpatialGrid::release(int ci, int cj)
+{
+    const size_t mask = slots.size() - 1;
+    size_t hole = probe(chunk_key(ci, cj));
+    if (!directory.empty())
+    {
+        directory[(ci - dir_ci) + (cj - dir_cj) * static_cast<size_t>(dir_w)] = nullptr;
+        if (directory.size() > directory_slack * 4 * chunk_total + directory_min)
+            directory.clear();
+    }
+    if (spare.size() < max_spare)
+        spare.push_back(std::move(slots[hole].chunk));
+    slots[hole].chunk.reset();
+    --chunk_total;
+
+    for (size_t i = (hole + 1) & mask; slots[i].chunk; i = (i + 1) & mask)
+        if (((i - home_slot(slots[i].key, mask)) & mask) >= ((i - hole) & mask))
+        {
+            slots[hole] = std::move(slots[i]);
+            hole = i;
+        }
+}
+
+void SpatialGrid::insert(uint32_t key, int x, int y)
+{
+    const int i = cell_of(x);
+    const int j = cell_of(y);
+    Chunk &chunk = chunk_for(i >> chunk_bits, j >> chunk_bits);
+    chunk.cell(i, j).push(key, x, y);
+    ++chunk.count;
+    ++entries;
+}
+
+void SpatialGrid::remove(uint32_t key, int x, int y)
+{
+    const int i = cell_of(x);
+    const int j = cell_of(y);
+    Chunk *chunk = find_chunk(i >> chunk_bits, j >> chunk_bits);
+    if (!chunk)
+        return;
+    Cell &cell = chunk->cell(i, j);
+    const size_t index = cell.find(key);
+    if (index == cell.count)
+        return;
+    cell.erase(index);
+    --entries;
+    if (--chunk->count == 0)
+        release(i >> chunk_bits, j >> chunk_bits);
+}
+
+void SpatialGrid::relocate(uint32_t key, int old_x, int old_y, int x, int y)
+{
+    if (same_cell(old_x, old_y, x, y))
+    {
+        const int i = cell_of(x);
+        const int j = cell_of(y);
+        Chunk *chunk = find_chunk(i >> chunk_bits, j >> chunk_bits);
+        if (!chunk)
+            return;
+        Cell &cell = chunk->cell(i, j);
+        const size_t index = cell.find(key);
+        if (index == cell.count)
+            return;
+        cell.xs()[index] = x;
+        cell.ys()[index] = y;
+        return;
+    }
+
+    const size_t before = entries;
+    remove(key, old_x, old_y);
+    if (entries != before)
+        insert(key, x, y);
+}
+
+void SpatialGrid::clear()
+{
+    for (auto &slot : slots)
+        if (slot.chunk)
+        {
+            for (auto &cell : slot.chunk->cells)
+                cell.count = 0;
+            slot.chunk->count = 0;
+            if (spare.size() < max_spare)
+                spare.push_back(std::move(slot.chunk));
+            slot.chunk.reset();
+        }
+    chunk_total = 0;
+    entries = 0;
+    directory.clear();
+}
+
+bool SpatialGrid::same_cell(int x1, int y1, int x2, int y2) const
+{
+    return cell_of(x1) == cell_of(x2) && cell_of(y1) == cell_of(y2);
+}
+
+std::vector<uint32_t> SpatialGrid::neighbours(int x, int y, int radius) const
+{
+    std::vector<uint32_t> result;
+    for_each_neighbour(x, y, radius, [&result](uint32_t key) { result.push_back(key); });
+    return result;
+}
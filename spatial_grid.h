@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include "distance_kernel.h"
+
+// Uniform bucket grid over an unbounded plane. Cell side equals the
+// combat distance, so a radius query only has to look at the 3x3 block
+// around the point. Cells keep a copy of their entries' positions in
+// parallel arrays, so a query never leaves the cell and can test a whole
+// cell with the batch distance kernel. The three arrays share one
+// allocation to keep mostly empty cells small.
+//
+// Cells are grouped into chunks of chunk_side x chunk_side. A chunk is
+// allocated when its first entry arrives and released when its last one
+// leaves, and chunks are found through a hash table on their coordinates,
+// so memory follows the populated area rather than the map size. While the
+// chunks' bounding box is densely populated, a flat directory over the box
+// answers lookups instead, saving the probe on crowded maps.
+class SpatialGrid
+{
+private:
+    struct Cell
+    {
+        // capacity keys, then capacity xs, then capacity ys.
+        std::unique_ptr<int[]> data;
+        uint32_t count{0};
+        uint32_t capacity{0};
+
+        uint32_t *keys() { return reinterpret_cast<uint32_t *>(data.get()); }
+        int *xs() { return data.get() + capacity; }
+        int *ys() { return data.get() + 2 * capacity; }
+        const uint32_t *keys() const { return reinterpret_cast<const uint32_t *>(data.get()); }
+        const int *xs() const { return data.get() + capacity; }
+        const int *ys() const { return data.get() + 2 * capacity; }
+
+        size_t find(uint32_t key) const;
+        void push(uint32_t key, int x, int y);
+        void erase(size_t index);
+    };
+
+public:
+    static constexpr int chunk_bits = 2;
+    static constexpr int chunk_side = 1 << chunk_bits;
+
+private:
+    struct Chunk
+    {
+        Cell cells[chunk_side * chunk_side];
+        size_t count{0};
+
+        Cell &cell(int i, int j) { return cells[(i & (chunk_side - 1)) + (j & (chunk_side - 1)) * chunk_side]; }
+    };
+
+    // Cells smaller than kernel_min are tested inline; the call into the
+    // batch kernel only pays off for crowded cells.
+    static constexpr size_t kernel_min = 16;
+    static constexpr size_t query_block = 64;
+    // Released chunks kept for reuse, so NPCs crossing a chunk border do
+    // not allocate every tick.
+    static constexpr size_t max_spare = 16;
+    static constexpr size_t max_cached = 16;
+    static constexpr size_t directory_slack = 4;
+    static constexpr size_t directory_min = 256;
+
+    int cell_size;
+    struct Slot
+    {
+        uint64_t key{0};
+        std::unique_ptr<Chunk> chunk;
+    };
+
+    // Open-addressing table of chunks, at most half full; a null chunk
+    // marks a free slot.
+    std::vector<Slot> slots;
+    std::vector<std::unique_ptr<Chunk>> spare;
+    size_t chunk_total{0};
+    // Empty when the box is too sparse; otherwise every chunk lies inside.
+    std::vector<Chunk *> directory;
+    int dir_ci{0};
+    int dir_cj{0};
+    int dir_w{0};
+    int dir_h{0};
+    size_t entries{0};
+
+    int cell_of(int v) const { return v >= 0 ? v / cell_size : -static_cast<int>((-static_cast<long long>(v) + cell_size - 1) / cell_size); }
+    static uint64_t chunk_key(int ci, int cj)
+    {
+        return static_cast<uint64_t>(static_cast<uint32_t>(ci)) << 32 | static_cast<uint32_t>(cj);
+    }
+    static size_t home_slot(uint64_t key, size_t mask) { return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask; }
+    size_t probe(uint64_t key) const;
+    Chunk *find_chunk(int ci, int cj) const
+    {
+        if (directory.empty())
+            return slots[probe(chunk_key(ci, cj))].chunk.get();
+        const unsigned di = static_cast<unsigned>(ci - dir_ci);
+        const unsigned dj = static_cast<unsigned>(cj - dir_cj);
+        return di < static_cast<unsigned>(dir_w) && dj < static_cast<unsigned>(dir_h) ? directory[di + dj * dir_w] : nullptr;
+    }
+    Chunk &chunk_for(int ci, int cj);
+    void release(int ci, int cj);
+    void rehash(size_t capacity);
+    void rebuild_directory();
+
+    template <typename F>
+    void scan_cell(const Cell &cell, int x, int y, int radius, long long r2, F &f) const;
+
+public:
+    explicit SpatialGrid(int cell_size);
+
+    void insert(uint32_t key, int x, int y);
+    void remove(uint32_t key, int x, int y);
+    void relocate(uint32_t key, int old_x, int old_y, int x, int y);
+    void clear();
+
+    bool same_cell(int x1, int y1, int x2, int y2) const;
+    size_t size() const { return entries; }
+    // Chunks currently allocated.
+    size_t chunk_count() const { return chunk_total; }
+
+    template <typename F>
+    void for_each_neighbour(int x, int y, int radius, F &&f) const;
+
+    std::vector<uint32_t> neighbours(int x, int y, int radius) const;
+};
+
+template <typename F>
+void SpatialGrid::scan_cell(const Cell &cell, int x, int y, int radius, long long r2, F &f) const
+{
+    const uint32_t *keys = cell.keys();
+    const int *xs = cell.xs();
+    const int *ys = cell.ys();
+    if (cell.count < kernel_min)
+    {
+        for (size_t k = 0; k < cell.count; ++k)
+        {
+            const long long dx = xs[k] - x;
+            const long long dy = ys[k] - y;
+            if (dx * dx + dy * dy <= r2)
+                f(keys[k]);
+        }
+        return;
+    }
+    for (size_t base = 0; base < cell.count; base += query_block)
+    {
+        uint32_t hits[query_block];
+        const size_t count = std::min<size_t>(query_block, cell.count - base);
+        const size_t found = within_radius(x, y, xs + base, ys + base, count, radius, hits);
+        for (size_t k = 0; k < found; ++k)
+            f(keys[base + hits[k]]);
+    }
+}
+
+// Cells are visited row by row across the whole block, whatever chunks
+// they fall in; the chunks covering the block are looked up once.
+template <typename F>
+void SpatialGrid::for_each_neighbour(int x, int y, int radius, F &&f) const
+{
+    if (entries == 0)
+        return;
+    const long long r2 = static_cast<long long>(radius) * radius;
+    const int reach = (radius + cell_size - 1) / cell_size;
+    const int i0 = cell_of(x) - reach;
+    const int i1 = cell_of(x) + reach;
+    const int j0 = cell_of(y) - reach;
+    const int j1 = cell_of(y) + reach;
+    const int ci0 = i0 >> chunk_bits;
+    const int cj0 = j0 >> chunk_bits;
+    const int span_i = (i1 >> chunk_bits) - ci0 + 1;
+    const int span_j = (j1 >> chunk_bits) - cj0 + 1;
+
+    const Chunk *cached[max_cached];
+    std::vector<const Chunk *> overflow;
+    const Chunk **covering = cached;
+    if (static_cast<size_t>(span_i) * span_j > max_cached)
+    {
+        overflow.resize(static_cast<size_t>(span_i) * span_j);
+        covering = overflow.data();
+    }
+    bool any = false;
+    for (int cj = 0; cj < span_j; ++cj)
+        for (int ci = 0; ci < span_i; ++ci)
+        {
+            covering[ci + cj * span_i] = find_chunk(ci0 + ci, cj0 + cj);
+            any |= covering[ci + cj * span_i] != nullptr;
+        }
+    if (!any)
+        return;
+
+    for (int j = j0; j <= j1; ++j)
+    {
+        const Chunk *const *row = covering + ((j >> chunk_bits) - cj0) * span_i;
+        for (int i = i0; i <= i1; ++i)
+        {
+            const Chunk *chunk = row[(i >> chunk_bits) - ci0];
+            if (!chunk)
+            {
+                i |= chunk_side - 1;
+                continue;
+            }
+            scan_cell(chunk->cells[(i & (chunk_side - 1)) + (j & (chunk_side - 1)) * chunk_side], x, y, radius, r2, f);
+        }
+    }
+}
@@ -5,6 +5,28 @@
 #include "Elf.h"
 #include "factory.h"
 #include "observers.h"
+#include "spatial_grid.h"
+#include "distance_kernel.h"
+#include "world.h"
+#include "fight_queue.h"
+#include "fight_manager.h"
+#include "fight_rules.h"
+#include "npc_pool.h"
+#include "simulation.h"
+#include "generator.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "async_logger.h"
+#include "event_bus.h"
+#include "metrics.h"
+#include "grid_renderer.h"
+#include "text_loader.h"
+#include "name_table.h"
+#include "tile_pool.h"
+#include "kill_stats.h"
+#include <thread>
+#include <atomic>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <fstream>
@@ -318,7 +340,1185 @@ TEST(CombatTest, NoFightWhenDead) {
     EXPECT_TRUE(dragon->fight(knight));
 }
 
+TEST(SpatialGridTest, MatchesPairwiseScan) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> coord(0, 500);
+    vector<shared_ptr<NPC>> npcs;
+    SpatialGrid grid(30);
+    for (uint32_t i = 0; i < 300; ++i) {
+        npcs.push_back(make_shared<Elf>(coord(rng), coord(rng), "E"));
+        const auto [x, y] = npcs.back()->position();
+        grid.insert(i, x, y);
+    }
+
+    for (auto &npc : npcs) {
+        const auto [x, y] = npc->position();
+        auto found = grid.neighbours(x, y, 30);
+        size_t expected = 0;
+        for (auto &other : npcs)
+            if (npc->is_close(other, 30))
+                ++expected;
+        EXPECT_EQ(found.size(), expected);
+    }
+
+    for (uint32_t i = 0; i < npcs.size(); ++i) {
+        const auto [x, y] = npcs[i]->position();
+        grid.remove(i, x, y);
+    }
+    EXPECT_EQ(grid.size(), 0);
+}
+
+TEST(SpatialGridTest, SparseChunksFollowPopulation) {
+    SpatialGrid grid(10);
+    const int far = 1 << 30;
+    grid.insert(0, 0, 0);
+    grid.insert(1, far, far);
+    grid.insert(2, far - 5, far);
+    grid.insert(3, -45, -38);
+    EXPECT_EQ(grid.chunk_count(), 3u);
+    EXPECT_EQ(grid.neighbours(far, far, 10).size(), 2u);
+    EXPECT_EQ(grid.neighbours(-40, -40, 10).size(), 1u);
+
+    // Walking across chunk borders keeps one chunk alive for the walker.
+    for (int x = far; x > far - 1000; x -= 7) {
+        grid.relocate(1, x, far, x - 7, far);
+        ASSERT_EQ(grid.neighbours(x - 7, far, 0).size(), 1u);
+    }
+    EXPECT_LE(grid.chunk_count(), 4u);
+
+    grid.remove(1, far - 1001, far);
+    grid.remove(2, far - 5, far);
+    grid.remove(3, -45, -38);
+    EXPECT_EQ(grid.chunk_count(), 1u);
+    EXPECT_EQ(grid.size(), 1u);
+    grid.clear();
+    EXPECT_EQ(grid.chunk_count(), 0u);
+    EXPECT_TRUE(grid.neighbours(0, 0, 10).empty());
+}
+
+TEST(SpatialGridTest, MoveUpdatesCell) {
+    auto elf = make_shared<Elf>(5, 5, "Mover");
+    World world;
+    world.add(elf);
+    world.build_grid(10);
+
+    EXPECT_EQ(world.spatial()->neighbours(5, 5, 3).size(), 1);
+    elf->move(20, 20, 500, 500);
+    EXPECT_TRUE(world.spatial()->neighbours(5, 5, 3).empty());
+    EXPECT_EQ(world.spatial()->neighbours(25, 25, 3).size(), 1);
+}
+
+TEST(DistanceKernelTest, MatchesScalar) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> coord(0, 200);
+    std::vector<int> xs(1003);
+    std::vector<int> ys(1003);
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        xs[i] = coord(rng);
+        ys[i] = coord(rng);
+    }
+
+    std::vector<uint32_t> fast(xs.size());
+    std::vector<uint32_t> slow(xs.size());
+    for (int radius : {0, 1, 10, 30, 150, 100000})
+    {
+        const size_t found = within_radius(100, 100, xs.data(), ys.data(), xs.size(), radius, fast.data());
+        const size_t expected = within_radius_scalar(100, 100, xs.data(), ys.data(), xs.size(), radius, slow.data());
+        ASSERT_EQ(found, expected) << distance_kernel_name() << " radius " << radius;
+        for (size_t i = 0; i < found; ++i)
+            EXPECT_EQ(fast[i], slow[i]);
+    }
+
+    EXPECT_EQ(within_radius(100, 100, xs.data(), ys.data(), xs.size(), 100000, fast.data()), xs.size());
+}
+
+TEST(WorldTest, AddBindsObjects) {
+    World world;
+    auto dragon = NPCFactory::create(DragonType, 10, 20, "WorldDragon");
+    npc_id id = world.add(dragon);
+
+    EXPECT_EQ(world.size(), 1);
+    EXPECT_EQ(dragon->get_world(), &world);
+    EXPECT_EQ(world.x(world.index_of(id)), 10);
+
+    dragon->move(5, 5, 500, 500);
+    EXPECT_EQ(world.position(id), make_pair(15, 25));
+    EXPECT_EQ(dragon->position(), make_pair(15, 25));
+
+    dragon->must_die();
+    EXPECT_FALSE(world.is_alive_id(id));
+    EXPECT_FALSE(dragon->is_alive());
+}
+
+TEST(WorldTest, StableIdsAfterRemove) {
+    World world;
+    auto a = NPCFactory::create(DragonType, 1, 1, "A");
+    auto b = NPCFactory::create(KnightType, 2, 2, "B");
+    auto c = NPCFactory::create(ElfType, 3, 3, "C");
+    npc_id ia = world.add(a);
+    npc_id ib = world.add(b);
+    npc_id ic = world.add(c);
+
+    EXPECT_TRUE(world.remove(ia));
+    EXPECT_FALSE(world.contains(ia));
+    EXPECT_EQ(a->get_world(), nullptr);
+    EXPECT_EQ(a->position(), make_pair(1, 1));
+
+    EXPECT_EQ(world.size(), 2);
+    EXPECT_EQ(world.position(ib), make_pair(2, 2));
+    EXPECT_EQ(world.position(ic), make_pair(3, 3));
+    EXPECT_EQ(world.object(world.index_of(ic)), c);
+}
+
+TEST(WorldTest, RemoveDeadKeepsSurvivors) {
+    World world;
+    for (int i = 0; i < 10; ++i)
+        world.add(NPCFactory::create(ElfType, i, i, ""));
+    for (size_t i = 0; i < world.size(); i += 2)
+        world.object(i)->must_die();
+
+    world.remove_dead();
+    EXPECT_EQ(world.size(), 5);
+    EXPECT_EQ(world.alive_count(), 5);
+}
+
+TEST(WorldTest, SaveLoadThroughView) {
+    World world;
+    world.add(NPCFactory::create(DragonType, 1, 2, "D1"));
+    world.add(NPCFactory::create(KnightType, 3, 4, "K1"));
+    world.object(0)->move(10, 10, 500, 500);
+
+    save(world, "test_world.txt");
+    World loaded(load("test_world.txt"));
+    EXPECT_EQ(loaded.size(), 2);
+    EXPECT_EQ(world.view().size(), 2);
+
+    bool moved_found = false;
+    for (size_t i = 0; i < loaded.size(); ++i)
+        if (loaded.x(i) == 11 && loaded.y(i) == 12)
+            moved_found = true;
+    EXPECT_TRUE(moved_found);
+
+    EXPECT_NO_THROW(print_all(world));
+    remove("test_world.txt");
+}
+
+TEST(WorldTest, StagedMovesCommitTogether) {
+    World world;
+    world.add(make_shared<Dragon>(10, 10, "A"));
+    world.add(make_shared<Elf>(20, 20, "B"));
+    world.build_grid(10);
+
+    world.begin_moves();
+    world.stage_move(0, 30, 0, 100, 100);
+    world.stage_move(1, -5, 200, 100, 100);
+    EXPECT_EQ(world.x(0), 10);
+    EXPECT_EQ(world.y(1), 20);
+
+    world.commit_moves();
+    EXPECT_EQ(world.x(0), 40);
+    EXPECT_EQ(world.y(0), 10);
+    EXPECT_EQ(world.x(1), 15);
+    EXPECT_EQ(world.y(1), 20);
+    EXPECT_EQ(world.spatial()->neighbours(40, 10, 0).size(), 1u);
+    EXPECT_TRUE(world.spatial()->neighbours(10, 10, 0).empty());
+}
+
+TEST(WorldTest, AliveCountsPerType) {
+    World world;
+    world.add(make_shared<Dragon>(0, 0, "D"));
+    world.add(make_shared<Elf>(1, 1, "E1"));
+    const npc_id elf = world.add(make_shared<Elf>(2, 2, "E2"));
+    const npc_id knight = world.add(NPCFactory::create(KnightType, 3, 3, "K"));
+    EXPECT_EQ(world.alive_count(ElfType), 2u);
+
+    world.kill(elf);
+    world.kill(elf);
+    EXPECT_EQ(world.alive_count(ElfType), 1u);
+    world.remove(elf);
+    EXPECT_EQ(world.alive_count(ElfType), 1u);
+    world.remove(knight);
+    EXPECT_EQ(world.alive_count(KnightType), 0u);
+    EXPECT_EQ(world.alive_count(), 2u);
+}
+
+TEST(WorldTest, HandlesGoStaleOnRemove) {
+    World world;
+    auto dragon = NPCFactory::create(DragonType, 0, 0, "D");
+    npc_id id = world.add(dragon);
+    NpcHandle handle = world.handle_at(world.index_of(id));
+    EXPECT_EQ(world.resolve(handle), dragon.get());
+
+    world.remove(id);
+    EXPECT_EQ(world.resolve(handle), nullptr);
+
+    auto elf = NPCFactory::create(ElfType, 0, 0, "E");
+    EXPECT_EQ(world.add(elf), id);
+    EXPECT_EQ(world.resolve(handle), nullptr);
+    EXPECT_EQ(world.resolve(world.handle_at(world.index_of(id))), elf.get());
+
+    world.clear();
+    EXPECT_EQ(world.add(dragon), id);
+    EXPECT_EQ(world.resolve(handle), nullptr);
+}
+
+TEST(WorldTest, CompactMovesDeadToTail) {
+    World world;
+    vector<npc_id> ids;
+    for (int i = 0; i < 6; ++i)
+        ids.push_back(world.add(NPCFactory::create(KnightType, i, i, "K")));
+    EXPECT_EQ(world.live_end(), 6u);
+
+    world.kill(ids[0]);
+    world.kill(ids[3]);
+    world.kill(ids[5]);
+    world.compact();
+    EXPECT_EQ(world.live_end(), 3u);
+    for (size_t i = 0; i < world.size(); ++i) {
+        EXPECT_EQ(world.is_alive(i), i < world.live_end());
+        EXPECT_EQ(world.index_of(world.id_at(i)), i);
+        EXPECT_EQ(world.object(i)->get_id(), world.id_at(i));
+    }
+    EXPECT_EQ(world.position(ids[4]), make_pair(4, 4));
+
+    world.add(NPCFactory::create(ElfType, 9, 9, "E"));
+    EXPECT_EQ(world.live_end(), 7u);
+    world.remove_dead();
+    EXPECT_EQ(world.size(), 4u);
+    EXPECT_EQ(world.live_end(), 4u);
+    EXPECT_EQ(world.alive_count(), 4u);
+}
+
+TEST(FightQueueTest, FifoAndCapacity) {
+    MpmcQueue<int> queue(4);
+    EXPECT_EQ(queue.capacity(), 4);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.try_push(int(i)));
+    EXPECT_FALSE(queue.try_push(99));
+    EXPECT_EQ(queue.size(), 4);
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(FightQueueTest, ConcurrentProducersConsumers) {
+    const int producers = 4;
+    const int per_producer = 20000;
+    MpmcQueue<int> queue(1024);
+    std::atomic<long long> sum{0};
+    std::atomic<int> received{0};
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 3; ++c)
+        consumers.emplace_back([&] {
+            std::vector<int> batch(32);
+            size_t count;
+            while ((count = queue.pop_wait_bulk(batch.begin(), batch.size())) > 0)
+                for (size_t i = 0; i < count; ++i) {
+                    sum += batch[i];
+                    ++received;
+                }
+        });
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&queue] {
+            for (int i = 1; i <= per_producer; ++i)
+                while (!queue.try_push(int(i)))
+                    std::this_thread::yield();
+        });
+    for (auto &t : threads)
+        t.join();
+
+    queue.close();
+    for (auto &t : consumers)
+        t.join();
+
+    EXPECT_EQ(received.load(), producers * per_producer);
+    EXPECT_EQ(sum.load(), 1LL * producers * per_producer * (per_producer + 1) / 2);
+}
+
+TEST(NpcPoolTest, FactoryObjectsReturnToPool) {
+    NpcPool &pool = NpcPool::get();
+    const size_t before = pool.in_use();
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        for (int i = 0; i < 1000; ++i)
+            npcs.push_back(NPCFactory::create(static_cast<NpcType>(i % 3 + 1), i, i));
+        EXPECT_EQ(pool.in_use(), before + 1000);
+
+        auto observer = make_shared<MockObserver>();
+        npcs[0]->subscribe(observer);
+        npcs[0]->fight(npcs[1]);
+        EXPECT_EQ(observer->last_attacker, npcs[0]);
+        observer->last_attacker.reset();
+        observer->last_defender.reset();
+    }
+    EXPECT_EQ(pool.in_use(), before);
+
+    const size_t slabs = pool.slab_count();
+    for (int i = 0; i < 1000; ++i)
+        NPCFactory::create(DragonType, 0, 0);
+    EXPECT_EQ(pool.slab_count(), slabs);
+}
+
+TEST(NpcPoolTest, LargeBlocksFallBackToHeap) {
+    NpcPool &pool = NpcPool::get();
+    const size_t before = pool.in_use();
+    void *p = pool.allocate(NpcPool::max_block + 1, alignof(std::max_align_t));
+    EXPECT_EQ(pool.in_use(), before);
+    pool.deallocate(p, NpcPool::max_block + 1, alignof(std::max_align_t));
+}
+
+TEST(FightRulesTest, TableMatchesFights) {
+    std::vector<std::shared_ptr<NPC>> npcs = {
+        make_shared<Dragon>(0, 0, "Dragon"),
+        make_shared<Knight>(0, 0, "Knight"),
+        make_shared<Elf>(0, 0, "Elf")
+    };
+    for (auto &attacker : npcs)
+        for (auto &defender : npcs)
+            EXPECT_EQ(attacker->defeats(*defender), beats(attacker->get_type(), defender->get_type()));
+
+    EXPECT_EQ(fight_outcome(DragonType, DragonType), 3);
+    EXPECT_EQ(fight_outcome(KnightType, DragonType), 3);
+    EXPECT_EQ(fight_outcome(ElfType, KnightType), 1);
+    EXPECT_EQ(fight_outcome(ElfType, DragonType), 2);
+    EXPECT_EQ(fight_outcome(ElfType, ElfType), 0);
+}
+
+TEST(FightRulesTest, BatchOutcomes) {
+    const NpcType attackers[] = {DragonType, KnightType, ElfType, ElfType};
+    const NpcType defenders[] = {ElfType, ElfType, KnightType, ElfType};
+    uint8_t outcomes[4];
+    fight_outcomes(attackers, defenders, outcomes, 4);
+
+    for (size_t i = 0; i < 4; ++i)
+        EXPECT_EQ(outcomes[i], fight_outcome(attackers[i], defenders[i]));
+}
+
+TEST(FightManagerTest, ResolveMutualKill) {
+    auto dragon1 = make_shared<Dragon>(0, 0, "Dragon1");
+    auto dragon2 = make_shared<Dragon>(0, 0, "Dragon2");
+    FightManager::resolve(*dragon1, *dragon2);
+    EXPECT_FALSE(dragon1->is_alive());
+    EXPECT_FALSE(dragon2->is_alive());
+
+    auto knight = make_shared<Knight>(0, 0, "Knight");
+    auto elf = make_shared<Elf>(0, 0, "Elf");
+    FightManager::resolve(*knight, *elf);
+    EXPECT_FALSE(knight->is_alive());
+    EXPECT_TRUE(elf->is_alive());
+}
+
+class ConcurrencyObserver : public IFightObserver {
+public:
+    std::mutex mtx;
+    std::map<NPC *, int> active;
+    std::atomic<int> fights{0};
+    std::atomic<bool> overlap{false};
+
+    void on_fight(const std::shared_ptr<NPC> attacker,
+                  const std::shared_ptr<NPC> defender,
+                  bool) override {
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            if (active[attacker.get()]++ > 0 || active[defender.get()]++ > 0)
+                overlap = true;
+        }
+        std::this_thread::yield();
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            active[attacker.get()]--;
+            active[defender.get()]--;
+        }
+        ++fights;
+    }
+};
+
+TEST(FightManagerTest, PoolEngagesEachNpcOnce) {
+    auto observer = make_shared<ConcurrencyObserver>();
+    World world;
+    vector<NpcHandle> knights;
+    for (int i = 0; i < 16; ++i) {
+        auto knight = make_shared<Knight>(0, 0, "K");
+        knight->subscribe(observer);
+        knights.push_back(world.handle_at(world.index_of(world.add(knight))));
+    }
+
+    FightManager &manager = FightManager::get();
+    manager.clear_events();
+    manager.start(world, 4);
+    EXPECT_EQ(manager.worker_count(), 4);
+
+    const int events = 2000;
+    for (int i = 0; i < events; ++i) {
+        auto &a = knights[i % knights.size()];
+        auto &b = knights[(i * 7 + 3) % knights.size()];
+        while (!manager.add_event({a, b}))
+            std::this_thread::yield();
+    }
+    manager.stop();
+
+    EXPECT_EQ(manager.worker_count(), 0);
+    EXPECT_FALSE(observer->overlap.load());
+    int self_fights = 0;
+    for (int i = 0; i < events; ++i)
+        if (i % knights.size() == (i * 7 + 3) % knights.size())
+            ++self_fights;
+    EXPECT_EQ(observer->fights.load(), 2 * (events - self_fights));
+}
+
+static vector<KillRecord> run_seeded(uint64_t seed) {
+    World world;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> coord(0, 200);
+    for (int i = 0; i < 300; ++i)
+        world.add(make_shared<Knight>(coord(rng), coord(rng), ""));
+    for (int i = 0; i < 100; ++i)
+        world.add(make_shared<Elf>(coord(rng), coord(rng), ""));
+    for (int i = 0; i < 20; ++i)
+        world.add(make_shared<Dragon>(coord(rng), coord(rng), ""));
+
+    SimulationConfig config;
+    config.max_x = 200;
+    config.max_y = 200;
+    config.distance = 10;
+    config.seed = seed;
+    Simulation simulation(world, config);
+    simulation.run(50);
+    EXPECT_EQ(simulation.ticks(), 50);
+    return simulation.kill_log();
+}
+
+TEST(GeneratorTest, SameSeedSameWorldAcrossThreads) {
+    for (Distribution distribution : {Distribution::Uniform, Distribution::Clustered, Distribution::Gaussian})
+    {
+        GeneratorConfig config;
+        config.count = 20000;
+        config.seed = 99;
+        config.distribution = distribution;
+        config.threads = 1;
+        World single;
+        generate(single, config);
+
+        config.threads = 4;
+        World parallel;
+        generate(parallel, config);
+
+        ASSERT_EQ(single.size(), config.count);
+        ASSERT_EQ(parallel.size(), config.count);
+        // Each call numbers its NPCs from its own base; within a call the
+        // name follows the index.
+        auto number = [](const World &world, size_t i) {
+            return std::stoull(string(world.object(i)->get_name().substr(4)));
+        };
+        const auto single_base = number(single, 0);
+        const auto parallel_base = number(parallel, 0);
+        for (size_t i = 0; i < single.size(); ++i)
+        {
+            ASSERT_EQ(single.type(i), parallel.type(i));
+            ASSERT_EQ(single.x(i), parallel.x(i));
+            ASSERT_EQ(single.y(i), parallel.y(i));
+            ASSERT_EQ(number(single, i) - single_base, i);
+            ASSERT_EQ(number(parallel, i) - parallel_base, i);
+        }
+    }
+}
+
+TEST(GeneratorTest, RatiosAndBounds) {
+    GeneratorConfig config;
+    config.count = 30000;
+    config.seed = 3;
+    config.max_x = 300;
+    config.max_y = 200;
+    config.distribution = Distribution::Gaussian;
+    ASSERT_TRUE(parse_ratios("1:0:2", config));
+    World world;
+    generate(world, config);
+
+    size_t counts[NpcTypeCount]{0};
+    for (size_t i = 0; i < world.size(); ++i)
+    {
+        counts[world.type(i)]++;
+        EXPECT_GE(world.x(i), 0);
+        EXPECT_LE(world.x(i), 300);
+        EXPECT_GE(world.y(i), 0);
+        EXPECT_LE(world.y(i), 200);
+    }
+    EXPECT_EQ(counts[KnightType], 0u);
+    EXPECT_NEAR(counts[ElfType] / double(counts[DragonType]), 2.0, 0.1);
+
+    EXPECT_FALSE(parse_ratios("1:2", config));
+    EXPECT_FALSE(parse_ratios("0:0:0", config));
+    EXPECT_FALSE(parse_ratios("4294967295:2:0", config));
+    EXPECT_FALSE(parse_ratios("-1:1:1", config));
+    EXPECT_FALSE(parse_ratios("1:-2:1", config));
+    EXPECT_TRUE(parse_ratios("16777216:16777216:16777216", config));
+    Distribution distribution;
+    EXPECT_TRUE(parse_distribution("clustered", distribution));
+    EXPECT_EQ(distribution, Distribution::Clustered);
+    EXPECT_FALSE(parse_distribution("spiral", distribution));
+}
+
+TEST(SimulationTest, SameSeedSameKills) {
+    auto first = run_seeded(42);
+    auto second = run_seeded(42);
+    ASSERT_EQ(first.size(), second.size());
+    EXPECT_FALSE(first.empty());
+    for (size_t i = 0; i < first.size(); ++i) {
+        EXPECT_EQ(first[i].tick, second[i].tick);
+        EXPECT_EQ(first[i].attacker, second[i].attacker);
+        EXPECT_EQ(first[i].defender, second[i].defender);
+    }
+}
+
+TEST(SimulationTest, KillsFollowRules) {
+    World world;
+    auto dragon = make_shared<Dragon>(10, 10, "D");
+    auto knight = make_shared<Knight>(10, 10, "K");
+    world.add(dragon);
+    world.add(knight);
+
+    SimulationConfig config;
+    config.distance = 5;
+    config.step = 0;
+    Simulation simulation(world, config);
+    simulation.tick();
+
+    EXPECT_FALSE(dragon->is_alive());
+    EXPECT_FALSE(knight->is_alive());
+    EXPECT_EQ(simulation.kill_log().size(), 2);
+}
+
+TEST(SchedulerTest, PhasesRunInOrder) {
+    TickScheduler scheduler;
+    vector<int> order;
+    scheduler.add_phase("a", [&] { order.push_back(1); });
+    scheduler.add_phase("b", [&] { order.push_back(2); });
+    scheduler.set_max_ticks(3);
+    scheduler.run();
+
+    EXPECT_EQ(scheduler.ticks(), 3);
+    EXPECT_EQ(order, vector<int>({1, 2, 1, 2, 1, 2}));
+    auto timings = scheduler.timings();
+    ASSERT_EQ(timings.size(), 2);
+    EXPECT_EQ(timings[0].name, "a");
+    EXPECT_EQ(timings[1].count, 3);
+}
+
+TEST(SchedulerTest, StopBeforeRunEndsRun) {
+    TickScheduler scheduler;
+    scheduler.add_phase("noop", [] {});
+    scheduler.stop();
+    scheduler.run();
+    EXPECT_EQ(scheduler.ticks(), 0);
+    EXPECT_FALSE(scheduler.is_running());
+}
+
+TEST(SchedulerTest, FixedTickRate) {
+    TickScheduler scheduler(100);
+    scheduler.add_phase("noop", [] {});
+    scheduler.set_max_ticks(10);
+
+    auto started = std::chrono::steady_clock::now();
+    scheduler.run();
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(90));
+}
+
+TEST(SimulationTest, PoolResolvePhaseWaitsForFights) {
+    World world;
+    auto dragon = make_shared<Dragon>(10, 10, "D");
+    auto elf = make_shared<Elf>(10, 10, "E");
+    world.add(dragon);
+    world.add(elf);
+
+    SimulationConfig config;
+    config.distance = 5;
+    config.step = 0;
+    Simulation simulation(world, config);
+
+    FightManager &manager = FightManager::get();
+    manager.clear_events();
+    manager.start(world, 2);
+    simulation.set_fight_manager(&manager);
+    simulation.tick();
+    EXPECT_EQ(manager.pending(), 0);
+    manager.stop();
+
+    EXPECT_TRUE(dragon->is_alive());
+    EXPECT_FALSE(elf->is_alive());
+}
+
+TEST(SnapshotTest, RoundTrip) {
+    World world;
+    world.add(NPCFactory::create(DragonType, 1, 2, "Snap Dragon"));
+    world.add(NPCFactory::create(KnightType, 3, 4, "K"));
+    world.add(NPCFactory::create(ElfType, 5, 6, ""));
+    world.object(1)->must_die();
+
+    ASSERT_TRUE(save_snapshot(world, "test_world.npcw"));
+    EXPECT_TRUE(is_snapshot_file("test_world.npcw"));
+    EXPECT_TRUE(has_snapshot_extension("test_world.npcw"));
+
+    SnapshotFile file("test_world.npcw");
+    ASSERT_TRUE(file.valid());
+    EXPECT_EQ(file.size(), 3);
+    EXPECT_EQ(file.name(0), "Snap Dragon");
+
+    World loaded;
+    ASSERT_TRUE(load_snapshot(loaded, "test_world.npcw"));
+    ASSERT_EQ(loaded.size(), 3);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(loaded.x(i), world.x(i));
+        EXPECT_EQ(loaded.y(i), world.y(i));
+        EXPECT_EQ(loaded.type(i), world.type(i));
+        EXPECT_EQ(loaded.is_alive(i), world.is_alive(i));
+        EXPECT_EQ(loaded.object(i)->get_name(), world.object(i)->get_name());
+    }
+    remove("test_world.npcw");
+}
+
+TEST(SnapshotTest, RejectsCorruptFile) {
+    World world;
+    world.add(NPCFactory::create(DragonType, 1, 2, "D"));
+    ASSERT_TRUE(save_snapshot(world, "test_corrupt.npcw"));
+
+    {
+        std::fstream fs("test_corrupt.npcw", std::ios::in | std::ios::out | std::ios::binary);
+        fs.seekp(sizeof(SnapshotHeader));
+        fs.put(0x7f);
+    }
+    SnapshotFile file("test_corrupt.npcw");
+    EXPECT_FALSE(file.valid());
+    EXPECT_EQ(file.error_message(), "data checksum mismatch");
+
+    World loaded;
+    EXPECT_FALSE(load_snapshot(loaded, "test_corrupt.npcw"));
+    EXPECT_FALSE(SnapshotFile("missing.npcw").valid());
+    EXPECT_FALSE(is_snapshot_file("missing.npcw"));
+    remove("test_corrupt.npcw");
+}
+
+TEST(SnapshotTest, RejectsWrappingNameRange) {
+    World world;
+    world.add(NPCFactory::create(DragonType, 1, 2, "D"));
+    ASSERT_TRUE(save_snapshot(world, "test_crafted.npcw"));
+
+    string bytes;
+    {
+        ifstream is("test_crafted.npcw", ios::binary);
+        bytes.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+    }
+    SnapshotHeader header;
+    SnapshotRecord record;
+    memcpy(&header, bytes.data(), sizeof(header));
+    memcpy(&record, bytes.data() + sizeof(header), sizeof(record));
+    record.name_offset = ~uint64_t(0);
+    memcpy(&bytes[sizeof(header)], &record, sizeof(record));
+    // A matching checksum, as a crafted file would carry.
+    header.data_checksum = fnv1a(bytes.data() + sizeof(header), bytes.size() - sizeof(header));
+    memcpy(&bytes[0], &header, sizeof(header));
+    {
+        ofstream os("test_crafted.npcw", ios::binary);
+        os.write(bytes.data(), bytes.size());
+    }
+
+    SnapshotFile file("test_crafted.npcw");
+    EXPECT_FALSE(file.valid());
+    EXPECT_EQ(file.error_message(), "name out of range");
+    remove("test_crafted.npcw");
+}
+
+static size_t count_kills(const string &filename) {
+    ifstream is(filename);
+    string line;
+    size_t count = 0;
+    while (getline(is, line))
+        if (line == "=== Kill ===")
+            ++count;
+    return count;
+}
+
+TEST(AsyncLoggerTest, NoRecordLostOnShutdown) {
+    remove("test_async.log");
+    const int threads = 4;
+    const int per_thread = 500;
+    {
+        AsyncLoggerConfig config;
+        config.ring_capacity = 8;
+        config.flush_interval = std::chrono::milliseconds(5);
+        AsyncKillLogger logger("test_async.log", config);
+
+        Dragon dragon(0, 0, "AsyncDragon");
+        Knight knight(0, 0, "AsyncKnight");
+        vector<thread> producers;
+        for (int t = 0; t < threads; ++t)
+            producers.emplace_back([&] {
+                for (int i = 0; i < per_thread; ++i)
+                    logger.log_kill(dragon, knight);
+            });
+        for (auto &p : producers)
+            p.join();
+    }
+    EXPECT_EQ(count_kills("test_async.log"), threads * per_thread);
+    remove("test_async.log");
+}
+
+TEST(AsyncLoggerTest, FlushWritesPendingRecords) {
+    remove("test_flush.log");
+    AsyncLoggerConfig config;
+    config.flush_interval = std::chrono::seconds(60);
+    AsyncKillLogger logger("test_flush.log", config);
+
+    const string long_name = "FlushElf" + string(100, 'e');
+    Elf elf(0, 0, long_name);
+    Knight knight(0, 0, "FlushKnight");
+    Dragon dragon(0, 0, "");
+    logger.log_kill(elf, knight);
+    logger.log_kill(dragon, elf);
+    logger.flush();
+
+    EXPECT_EQ(logger.written(), 2);
+    EXPECT_EQ(count_kills("test_flush.log"), 2);
+    ifstream is("test_flush.log");
+    string content((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+    EXPECT_NE(content.find("Defender: SKnight \"FlushKnight\""), string::npos);
+    EXPECT_NE(content.find("\"" + long_name + "\""), string::npos);
+    EXPECT_NE(content.find("\"" + string(dragon.get_name()) + "\""), string::npos);
+    remove("test_flush.log");
+}
+
+struct BusCounter {
+    int fights = 0;
+    int kills = 0;
+    int deaths = 0;
+    int moves = 0;
+    void on_fight(const OnFight &) { ++fights; }
+    void on_kill(const OnKill &) { ++kills; }
+    void on_death(const OnDeath &) { ++deaths; }
+    void on_move(const OnMove &) { ++moves; }
+};
+
+TEST(EventBusTest, TypedSubscriptions) {
+    EventBus bus;
+    BusCounter counter;
+    EXPECT_FALSE(bus.has_subscribers<OnMove>());
+    uint32_t token = bus.subscribe<OnMove, BusCounter, &BusCounter::on_move>(&counter);
+    EXPECT_TRUE(bus.has_subscribers<OnMove>());
+    EXPECT_FALSE(bus.has_subscribers<OnKill>());
+
+    bus.publish(OnMove{1, 0, 0, 1, 1});
+    EXPECT_EQ(counter.moves, 1);
+
+    EXPECT_TRUE(bus.unsubscribe<OnMove>(token));
+    EXPECT_FALSE(bus.unsubscribe<OnMove>(token));
+    bus.publish(OnMove{1, 0, 0, 1, 1});
+    EXPECT_EQ(counter.moves, 1);
+}
+
+TEST(EventBusTest, WorldPublishesEvents) {
+    World world;
+    BusCounter counter;
+    world.events().subscribe<OnFight, BusCounter, &BusCounter::on_fight>(&counter);
+    world.events().subscribe<OnKill, BusCounter, &BusCounter::on_kill>(&counter);
+    world.events().subscribe<OnDeath, BusCounter, &BusCounter::on_death>(&counter);
+    world.events().subscribe<OnMove, BusCounter, &BusCounter::on_move>(&counter);
+
+    auto knight = NPCFactory::create(KnightType, 0, 0, "K");
+    auto elf = NPCFactory::create(ElfType, 0, 0, "E");
+    world.add(knight);
+    world.add(elf);
+
+    knight->move(1, 1, 500, 500);
+    EXPECT_EQ(counter.moves, 1);
+
+    FightManager::resolve(*knight, *elf);
+    EXPECT_EQ(counter.fights, 2);
+    EXPECT_EQ(counter.kills, 1);
+    EXPECT_EQ(counter.deaths, 1);
+
+    knight->must_die();
+    EXPECT_EQ(counter.deaths, 1);
+}
+
+TEST(EventBusTest, PerNpcObserverStillOptIn) {
+    World world;
+    auto observer = make_shared<MockObserver>();
+    auto dragon = NPCFactory::create(DragonType, 0, 0, "D");
+    auto elf = NPCFactory::create(ElfType, 0, 0, "E");
+    world.add(dragon);
+    world.add(elf);
+    dragon->subscribe(observer);
+
+    dragon->fight(elf);
+    EXPECT_TRUE(observer->fight_observed);
+    EXPECT_EQ(observer->last_attacker, dragon);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+
+TEST(SimulationTest, StationaryContactsFightOnce) {
+    World world;
+    BusCounter counter;
+    world.events().subscribe<OnFight, BusCounter, &BusCounter::on_fight>(&counter);
+    for (int i = 0; i < 50; ++i)
+        world.add(make_shared<Knight>(10 + i % 5, 10 + i / 5, ""));
+
+    SimulationConfig config;
+    config.distance = 30;
+    config.step = 0;
+    Simulation simulation(world, config);
+
+    simulation.move_phase();
+    simulation.detect_phase();
+    EXPECT_EQ(simulation.pending_pairs(), 50u * 49 / 2);
+    simulation.resolve_phase();
+    EXPECT_EQ(counter.fights, 50 * 49);
+
+    simulation.tick();
+    EXPECT_EQ(counter.fights, 50 * 49);
+    EXPECT_EQ(simulation.contact_count(), 50u * 49 / 2);
+}
+
+TEST(SimulationTest, HarmlessPairsSkippedWithoutFightSubscribers) {
+    World world;
+    for (int i = 0; i < 50; ++i)
+        world.add(make_shared<Elf>(10, 10, ""));
+    world.add(make_shared<Knight>(10, 10, "K"));
+
+    SimulationConfig config;
+    config.distance = 5;
+    config.step = 0;
+    Simulation simulation(world, config);
+    simulation.move_phase();
+    simulation.detect_phase();
+
+    EXPECT_EQ(simulation.pending_pairs(), 50u);
+    simulation.resolve_phase();
+    EXPECT_EQ(simulation.kill_log().size(), 1u);
+    EXPECT_EQ(simulation.contact_count(), 0u);
+}
+
+TEST(SimulationTest, PairsCollectedInBoundedBatches) {
+    World world;
+    for (int i = 0; i < 200; ++i)
+        world.add(make_shared<Dragon>(10 + i % 3, 10, ""));
+
+    SimulationConfig config;
+    config.distance = 5;
+    config.step = 0;
+    config.max_pairs = 16;
+    Simulation simulation(world, config);
+    simulation.move_phase();
+    simulation.detect_phase();
+    EXPECT_LT(simulation.pending_pairs(), 16u + 200);
+
+    simulation.resolve_phase();
+    EXPECT_EQ(simulation.pending_pairs(), 0u);
+    EXPECT_EQ(world.alive_count(), 0u);
+    EXPECT_EQ(simulation.kill_log().size(), 200u);
+}
+
+static vector<KillRecord> run_threaded(size_t threads, size_t max_pairs) {
+    World world;
+    GeneratorConfig generator;
+    generator.count = 3000;
+    generator.seed = 11;
+    generator.max_x = 400;
+    generator.max_y = 400;
+    generator.distribution = Distribution::Clustered;
+    generate(world, generator);
+
+    SimulationConfig config;
+    config.max_x = 400;
+    config.max_y = 400;
+    config.distance = 8;
+    config.seed = 11;
+    config.threads = threads;
+    config.max_pairs = max_pairs;
+    Simulation simulation(world, config);
+    simulation.run(30);
+    return simulation.kill_log();
+}
+
+TEST(SimulationTest, TiledDetectMatchesSerial) {
+    for (size_t max_pairs : {size_t(16), size_t(1) << 16}) {
+        auto serial = run_threaded(1, max_pairs);
+        auto tiled = run_threaded(4, max_pairs);
+        ASSERT_EQ(serial.size(), tiled.size());
+        EXPECT_FALSE(serial.empty());
+        for (size_t i = 0; i < serial.size(); ++i) {
+            EXPECT_EQ(serial[i].tick, tiled[i].tick);
+            EXPECT_EQ(serial[i].attacker, tiled[i].attacker);
+            EXPECT_EQ(serial[i].defender, tiled[i].defender);
+        }
+    }
+}
+
+TEST(TilePoolTest, RunsEveryTaskOnce) {
+    TilePool pool(4);
+    EXPECT_EQ(pool.workers(), 4u);
+    for (size_t count : {0, 1, 3, 1000}) {
+        vector<atomic<int>> runs(count);
+        atomic<bool> bad_worker{false};
+        pool.run(count, [&](size_t task, size_t worker) {
+            runs[task]++;
+            if (worker >= 4)
+                bad_worker = true;
+        });
+        for (size_t i = 0; i < count; ++i)
+            EXPECT_EQ(runs[i].load(), 1);
+        EXPECT_FALSE(bad_worker.load());
+    }
+}
+
+TEST(KillStatsTest, MatchesKillLog) {
+    World world;
+    GeneratorConfig generator;
+    generator.count = 2000;
+    generator.seed = 5;
+    generator.max_x = 300;
+    generator.max_y = 300;
+    generate(world, generator);
+    size_t generator_alive[NpcTypeCount];
+    for (size_t t = 0; t < NpcTypeCount; ++t)
+        generator_alive[t] = world.alive_count(static_cast<NpcType>(t));
+
+    KillStats stats;
+    stats.attach(world);
+
+    SimulationConfig config;
+    config.max_x = 300;
+    config.max_y = 300;
+    config.seed = 5;
+    config.threads = 1;
+    Simulation simulation(world, config);
+    for (int i = 0; i < 20; ++i) {
+        stats.begin_tick(simulation.ticks());
+        simulation.tick();
+    }
+
+    EXPECT_EQ(stats.kills(), simulation.kill_log().size());
+    EXPECT_GT(stats.kills(), 0u);
+    EXPECT_EQ(world.live_end(), world.alive_count());
+    for (NpcType type : {DragonType, KnightType, ElfType})
+        EXPECT_EQ(stats.deaths(type), generator_alive[type] - world.alive_count(type));
+    EXPECT_EQ(stats.kills(KnightType, KnightType), 0u);
+    EXPECT_EQ(stats.kills_by(ElfType), stats.kills(ElfType, KnightType));
+
+    uint64_t bucketed = 0;
+    for (uint64_t n : stats.kill_rate(KillStats::bucket_count))
+        bucketed += n;
+    EXPECT_EQ(bucketed, stats.kills());
+
+    stats.detach();
+    EXPECT_FALSE(world.events().has_subscribers<OnKill>());
+}
+
+TEST(KillStatsTest, KillRateRing) {
+    KillStats stats(2);
+    stats.record(DragonType, ElfType);
+    stats.begin_tick(1);
+    stats.record(DragonType, ElfType);
+    stats.begin_tick(2);
+    stats.record(KnightType, DragonType);
+    EXPECT_EQ(stats.kill_rate(5), (vector<uint64_t>{2, 1}));
+    EXPECT_EQ(stats.deaths(ElfType), 2u);
+    EXPECT_EQ(stats.kills_by(KnightType), 1u);
+
+    stats.begin_tick(2 * KillStats::bucket_count + 2);
+    auto rate = stats.kill_rate(KillStats::bucket_count);
+    EXPECT_EQ(rate.size(), KillStats::bucket_count);
+    for (uint64_t n : rate)
+        EXPECT_EQ(n, 0u);
+    EXPECT_EQ(stats.kills(), 3u);
+}
+
+TEST(MetricsTest, ThreadCountersAggregate) {
+    const uint64_t before = Metrics::get().snapshot().counter(Metric::PairsTested);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i)
+                Metrics::add(Metric::PairsTested, 1);
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(Metrics::get().snapshot().counter(Metric::PairsTested), before + 4000);
+}
+
+TEST(MetricsTest, HistogramSummary) {
+    HistogramSummary h;
+    for (uint64_t v : {0, 1, 3, 100, 1000}) {
+        h.buckets[v ? 64 - __builtin_clzll(v) : 0]++;
+        h.count++;
+        h.sum += v;
+        h.max = std::max(h.max, v);
+    }
+    EXPECT_EQ(h.percentile(0.2), 0u);
+    EXPECT_EQ(h.percentile(0.6), 3u);
+    EXPECT_EQ(h.percentile(1.0), 1000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 220.8);
+
+    MetricsSnapshot snapshot;
+    snapshot.histograms[static_cast<size_t>(MetricHistogram::FightLatency)] = h;
+    stringstream json;
+    snapshot.write_json(json);
+    EXPECT_NE(json.str().find("\"fight_latency_ns\":{\"count\":5,\"sum\":1104,\"max\":1000"), string::npos);
+}
+
+TEST(GridRendererTest, RedrawsOnlyChangedCells) {
+    World world;
+    world.add(make_shared<Dragon>(0, 0, "D"));
+    const npc_id elf = world.add(make_shared<Elf>(99, 99, "E"));
+
+    GridRenderer renderer(10, 10);
+    renderer.draw(world, 99, 99);
+    const string first = renderer.compose("status\n");
+    EXPECT_NE(first.find("\033[2J"), string::npos);
+    EXPECT_EQ(first.find("[D][ ]"), first.find("[D]"));
+    EXPECT_NE(first.find("[E]"), string::npos);
+
+    renderer.draw(world, 99, 99);
+    EXPECT_EQ(renderer.compose("status\n"), "\033[16;1Hstatus\033[K\n\033[J");
+
+    world.kill(elf);
+    renderer.draw(world, 99, 99);
+    EXPECT_EQ(renderer.compose(""), "\033[14;28H[.]\033[16;1H\033[J");
+
+    renderer.invalidate();
+    renderer.draw(world, 99, 99);
+    EXPECT_NE(renderer.compose("").find("\033[2J"), string::npos);
+}
+
+TEST(GridRendererTest, ClampsGridSize) {
+    GridRenderer huge(1000000, 1000000);
+    EXPECT_EQ(huge.width(), GridRenderer::max_size);
+    EXPECT_EQ(huge.height(), GridRenderer::max_size);
+
+    GridRenderer empty(0, -3);
+    EXPECT_EQ(empty.width(), 1);
+    EXPECT_EQ(empty.height(), 1);
+}
+
+TEST(TextLoaderTest, SkipsMalformedRecordsWithLineNumbers) {
+    {
+        ofstream os("test_loader.txt");
+        os << "4\n";
+        os << "1\n10\n20\nFirst\n";
+        os << "7\n1\n2\nBadType\n";
+        os << "3\n5\n\n";
+        os << "2\n30\n40\nLast\n";
+    }
+    auto result = load_text("test_loader.txt");
+    ASSERT_TRUE(result.opened);
+    EXPECT_EQ(result.declared, 4u);
+    ASSERT_EQ(result.npcs.size(), 2u);
+    EXPECT_EQ(result.npcs[0]->get_name(), "First");
+    EXPECT_EQ(result.npcs[1]->get_type(), KnightType);
+    EXPECT_EQ(result.npcs[1]->position(), make_pair(30, 40));
+
+    vector<size_t> lines;
+    for (auto &error : result.errors)
+        lines.push_back(error.line);
+    // Parsing resumes line by line after the bad type on line 6.
+    ASSERT_FALSE(lines.empty());
+    EXPECT_EQ(lines.front(), 6u);
+    EXPECT_EQ(result.errors.front().message, "bad type: \"7\"");
+    remove("test_loader.txt");
+}
+
+TEST(TextLoaderTest, ChunkedParseMatchesSerial) {
+    {
+        ofstream os("test_loader.txt");
+        os << "300\n";
+        for (int i = 0; i < 300; ++i)
+        {
+            if (i % 37 == 5)
+                os << "x\n";
+            if (i % 53 == 7)
+            {
+                os << "2\n1\n";
+                continue;
+            }
+            os << (i % 3 + 1) << '\n' << i << '\n' << 2 * i << '\n' << "N" << i << '\n';
+        }
+    }
+
+    TextLoadConfig serial;
+    serial.threads = 1;
+    auto expected = load_text("test_loader.txt", serial);
+
+    // Tiny chunks hold a record each; larger ones rejoin their first parse
+    // part-way after a shifted boundary.
+    for (size_t chunk_bytes : {size_t(24), size_t(200)}) {
+        TextLoadConfig chunked;
+        chunked.threads = 4;
+        chunked.chunk_bytes = chunk_bytes;
+        size_t calls = 0;
+        size_t last = 0;
+        chunked.progress = [&](size_t done, size_t total) { ++calls; last = done; EXPECT_LE(done, total); };
+
+        World world;
+        auto result = load_text(world, "test_loader.txt", chunked);
+        EXPECT_GT(calls, 1u);
+        EXPECT_EQ(last, static_cast<size_t>(ifstream("test_loader.txt", ios::ate).tellg()));
+
+        ASSERT_EQ(world.size(), expected.npcs.size());
+        EXPECT_GT(world.size(), 280u);
+        for (size_t i = 0; i < world.size(); ++i)
+            EXPECT_EQ(world.object(i)->get_name(), expected.npcs[i]->get_name());
+        ASSERT_EQ(result.errors.size(), expected.errors.size());
+        for (size_t i = 0; i < result.errors.size(); ++i)
+            EXPECT_EQ(result.errors[i].line, expected.errors[i].line);
+        EXPECT_FALSE(result.errors.empty());
+    }
+    remove("test_loader.txt");
+}
+
+TEST(NameTableTest, InternsOnce) {
+    NameTable &table = NameTable::get();
+    const name_id a = table.intern("InternedName");
+    const string_view first = table.view(a);
+    for (int i = 0; i < 1000; ++i)
+        table.intern("Filler_" + to_string(i));
+    EXPECT_EQ(table.intern(string("Interned") + "Name"), a);
+    EXPECT_EQ(table.view(a).data(), first.data());
+    EXPECT_NE(table.intern("OtherName"), a);
+    EXPECT_EQ(table.view(NameTable::empty), "");
+}
+
+TEST(NameTableTest, AutoNamesAreLazyAndUnique) {
+    const size_t before = NameTable::get().size();
+    vector<shared_ptr<NPC>> npcs(4000);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&npcs, t] {
+            for (int i = t; i < 4000; i += 4)
+                npcs[i] = make_shared<Elf>(0, 0);
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(NameTable::get().size(), before);
+
+    set<string_view> names;
+    for (auto &npc : npcs)
+        names.insert(npc->get_name());
+    EXPECT_EQ(names.size(), npcs.size());
+    EXPECT_EQ(npcs[0]->get_name().substr(0, 4), "NPC_");
+    EXPECT_EQ(npcs[0]->get_name().data(), npcs[0]->get_name().data());
+
+    npcs[1]->set_name("Renamed");
+    EXPECT_EQ(npcs[1]->get_name(), "Renamed");
+}
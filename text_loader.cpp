@@ -0,0 +1,354 @@
+#include "text_loader.h"
+#include "factory.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t record_lines = 4;
+    // Line 1 is the count, records start on line 2.
+    constexpr size_t first_record_line = 2;
+
+    // Record starts remembered per chunk for resyncing a re-parse.
+    constexpr size_t resync_marks = 64;
+
+    // Where a parse stood at the start of a loop step, and how much it
+    // had produced by then.
+    struct Mark
+    {
+        const char *at;
+        size_t npcs;
+        size_t errors;
+    };
+
+    struct Chunk
+    {
+        const char *begin;
+        const char *end;
+        size_t first_line{0};
+        const char *stop{nullptr};
+        size_t stop_line{0};
+        std::vector<std::shared_ptr<NPC>> npcs;
+        std::vector<LoadError> errors;
+        std::vector<Mark> marks;
+
+        Chunk(const char *_begin, const char *_end) : begin(_begin), end(_end) {}
+    };
+
+    class Mapping
+    {
+    public:
+        const char *data{nullptr};
+        size_t size{0};
+        bool opened{false};
+
+        explicit Mapping(const std::string &filename)
+        {
+            const int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (::fstat(fd, &st) == 0)
+            {
+                opened = true;
+                size = static_cast<size_t>(st.st_size);
+                if (size > 0)
+                {
+                    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (mapping == MAP_FAILED)
+                    {
+                        opened = false;
+                        size = 0;
+                    }
+                    else
+                    {
+                        ::madvise(mapping, size, MADV_WILLNEED);
+                        data = static_cast<const char *>(mapping);
+                    }
+                }
+            }
+            ::close(fd);
+        }
+
+        ~Mapping()
+        {
+            if (data)
+                ::munmap(const_cast<char *>(data), size);
+        }
+
+        Mapping(const Mapping &) = delete;
+        Mapping &operator=(const Mapping &) = delete;
+    };
+
+    // Reads the line at p without its terminator and moves p past it.
+    bool next_line(const char *&p, const char *end, std::string_view &line)
+    {
+        if (p >= end)
+            return false;
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *stop = newline ? newline : end;
+        line = std::string_view(p, stop - p);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        p = newline ? newline + 1 : end;
+        return true;
+    }
+
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    template <typename T>
+    bool parse_number(std::string_view s, T &out)
+    {
+        s = trim(s);
+        const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return !s.empty() && ec == std::errc() && ptr == s.data() + s.size();
+    }
+
+    LoadError make_error(size_t line, const char *problem, std::string_view text)
+    {
+        constexpr size_t max_quote = 40;
+        std::string message = problem;
+        message += ": \"";
+        message.append(text.substr(0, max_quote));
+        if (text.size() > max_quote)
+            message += "...";
+        message += '"';
+        return {line, std::move(message)};
+    }
+
+    // Parses the records starting in [begin, end); the last one may run past
+    // end. Blank lines between records are skipped. The parse only depends
+    // on where it stands, so a re-parse given the chunk's first parse as
+    // `resync` stops as soon as it reaches a step that parse also took
+    // (one of its first resync_marks) and takes the rest over from it.
+    void parse_chunk(Chunk &chunk, const char *file_end, Chunk *resync = nullptr)
+    {
+        chunk.npcs.clear();
+        chunk.errors.clear();
+        chunk.marks.clear();
+        const char *p = chunk.begin;
+        size_t line = chunk.first_line;
+        std::string_view fields[record_lines];
+        while (p < chunk.end)
+        {
+            if (resync)
+            {
+                const auto &marks = resync->marks;
+                auto mark = std::lower_bound(marks.begin(), marks.end(), p,
+                                             [](const Mark &m, const char *at) { return m.at < at; });
+                if (mark != marks.end() && mark->at == p)
+                {
+                    std::move(resync->npcs.begin() + mark->npcs, resync->npcs.end(), std::back_inserter(chunk.npcs));
+                    std::move(resync->errors.begin() + mark->errors, resync->errors.end(), std::back_inserter(chunk.errors));
+                    chunk.stop = resync->stop;
+                    chunk.stop_line = resync->stop_line;
+                    return;
+                }
+            }
+            if (chunk.marks.size() < resync_marks)
+                chunk.marks.push_back({p, chunk.npcs.size(), chunk.errors.size()});
+
+            const char *q = p;
+            size_t read = 0;
+            while (read < record_lines && next_line(q, file_end, fields[read]))
+                ++read;
+
+            if (trim(fields[0]).empty())
+            {
+                next_line(p, file_end, fields[0]);
+                ++line;
+                continue;
+            }
+            if (read < record_lines)
+            {
+                chunk.errors.push_back(make_error(line, "truncated record", fields[0]));
+                p = file_end;
+                break;
+            }
+
+            int type = 0;
+            int x = 0;
+            int y = 0;
+            const char *problem = nullptr;
+            size_t field = 0;
+            if (!parse_number(fields[0], type) || type <= Unknown || type >= NpcTypeCount)
+                problem = "bad type";
+            else if (!parse_number(fields[field = 1], x))
+                problem = "bad x";
+            else if (!parse_number(fields[field = 2], y))
+                problem = "bad y";
+            if (problem)
+            {
+                chunk.errors.push_back(make_error(line + field, problem, fields[field]));
+                next_line(p, file_end, fields[0]);
+                ++line;
+                continue;
+            }
+
+            std::string_view name = fields[3];
+            while (!name.empty() && (name.front() == ' ' || name.front() == '\t'))
+                name.remove_prefix(1);
+            chunk.npcs.push_back(NPCFactory::create(static_cast<NpcType>(type), x, y, name));
+            p = q;
+            line += record_lines;
+        }
+        chunk.stop = p;
+        chunk.stop_line = line;
+    }
+
+    template <typename F>
+    void parallel_for(size_t count, size_t threads, F &&f)
+    {
+        std::atomic<size_t> next{0};
+        auto work = [&]()
+        {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+                f(i);
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < std::min(threads, count); ++t)
+            workers.emplace_back(work);
+        work();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    // Cuts [begin, end) into chunks of about chunk_bytes that start on a
+    // record boundary of a well-formed file, numbering their first lines.
+    std::vector<Chunk> split(const char *begin, const char *end, size_t chunk_bytes, size_t threads)
+    {
+        std::vector<Chunk> raw;
+        for (const char *p = begin; p < end;)
+        {
+            const char *q = end;
+            if (static_cast<size_t>(end - p) > chunk_bytes)
+            {
+                const char *newline = static_cast<const char *>(std::memchr(p + chunk_bytes, '\n', end - p - chunk_bytes));
+                q = newline ? newline + 1 : end;
+            }
+            raw.push_back({p, q});
+            p = q;
+        }
+
+        std::vector<size_t> lines(raw.size());
+        parallel_for(raw.size(), threads, [&](size_t i)
+        {
+            lines[i] = static_cast<size_t>(std::count(raw[i].begin, raw[i].end, '\n'));
+        });
+
+        std::vector<Chunk> chunks;
+        size_t line = first_record_line;
+        for (size_t i = 0; i < raw.size(); ++i)
+        {
+            const char *start = raw[i].begin;
+            size_t start_line = line;
+            std::string_view skipped;
+            while (start < end && (start_line - first_record_line) % record_lines != 0)
+            {
+                next_line(start, end, skipped);
+                ++start_line;
+            }
+            line += lines[i];
+            if (!chunks.empty())
+            {
+                if (start >= end || start <= chunks.back().begin)
+                    continue;
+                chunks.back().end = start;
+            }
+            Chunk chunk{start, end};
+            chunk.first_line = start_line;
+            chunks.push_back(std::move(chunk));
+        }
+        return chunks;
+    }
+}
+
+TextLoadResult load_text(const std::string &filename, const TextLoadConfig &config)
+{
+    TextLoadResult result;
+    Mapping file(filename);
+    result.opened = file.opened;
+    if (!file.data)
+        return result;
+
+    const char *const end = file.data + file.size;
+    const char *body = file.data;
+    std::string_view header;
+    next_line(body, end, header);
+    if (!parse_number(header, result.declared))
+        result.errors.push_back(make_error(1, "bad record count", header));
+
+    const size_t threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Chunk> chunks = split(body, end, std::max<size_t>(config.chunk_bytes, 1), threads);
+
+    std::mutex progress_mtx;
+    size_t done = body - file.data;
+    parallel_for(chunks.size(), threads, [&](size_t i)
+    {
+        parse_chunk(chunks[i], end);
+        if (config.progress)
+        {
+            std::lock_guard<std::mutex> lck(progress_mtx);
+            done += chunks[i].end - chunks[i].begin;
+            config.progress(done, file.size);
+        }
+    });
+
+    // A skipped line can leave the record grid off by a few lines at the
+    // next boundary; redo that chunk from where its predecessor stopped. The
+    // first parse falls back into step after a few bad records, so the redo
+    // usually rejoins it within a record or two and keeps the rest.
+    for (size_t i = 1; i < chunks.size(); ++i)
+    {
+        const Chunk &prev = chunks[i - 1];
+        Chunk &chunk = chunks[i];
+        if (prev.stop == chunk.begin)
+            continue;
+        Chunk redo(std::min(prev.stop, chunk.end), chunk.end);
+        redo.first_line = prev.stop_line;
+        parse_chunk(redo, end, &chunk);
+        if (redo.begin == redo.end)
+        {
+            redo.stop = prev.stop;
+            redo.stop_line = prev.stop_line;
+        }
+        chunk = std::move(redo);
+    }
+
+    size_t total = 0;
+    for (const auto &chunk : chunks)
+        total += chunk.npcs.size();
+    result.npcs.reserve(total);
+    for (auto &chunk : chunks)
+    {
+        std::move(chunk.npcs.begin(), chunk.npcs.end(), std::back_inserter(result.npcs));
+        std::move(chunk.errors.begin(), chunk.errors.end(), std::back_inserter(result.errors));
+    }
+    return result;
+}
+
+TextLoadResult load_text(World &world, const std::string &filename, const TextLoadConfig &config)
+{
+    world.clear();
+    TextLoadResult result = load_text(filename, config);
+    world.reserve(result.npcs.size());
+    for (const auto &npc : result.npcs)
+        world.add(npc);
+    return result;
+}
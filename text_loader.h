@@ -0,0 +1,51 @@
+#pragma once
+
+#include "world.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Parallel loader for the text world format written by save():
+//
+//   count
+//   type \n x \n y \n name      one line each, repeated per NPC
+//
+// The file is memory-mapped and cut into chunks on record boundaries;
+// worker threads parse chunks independently and the results are joined in
+// file order. A malformed record is skipped and reported with its line
+// number, and parsing resumes on the next line. If a skip shifts the record
+// grid across a chunk boundary, the next chunk is parsed again from where
+// the previous one stopped, so the result always matches a serial parse.
+// That re-parse runs on the calling thread but only until it meets a record
+// the chunk's own parse started from (within its first 64 steps), which
+// is normally a record or two in; only a chunk whose first 64 steps never
+// line up is parsed again in full.
+struct TextLoadConfig
+{
+    // 0 picks std::thread::hardware_concurrency().
+    size_t threads{0};
+    size_t chunk_bytes{4 << 20};
+    // Bytes parsed so far and the file size. Calls are serialized but may
+    // come from any loader thread.
+    std::function<void(size_t done, size_t total)> progress;
+};
+
+struct LoadError
+{
+    size_t line;
+    std::string message;
+};
+
+struct TextLoadResult
+{
+    bool opened{false};
+    // Count from the header line; the records actually present win.
+    size_t declared{0};
+    std::vector<std::shared_ptr<NPC>> npcs;
+    std::vector<LoadError> errors;
+};
+
+TextLoadResult load_text(const std::string &filename, const TextLoadConfig &config = {});
+// Replaces the world's contents with the file's NPCs.
+TextLoadResult load_text(World &world, const std::string &filename, const TextLoadConfig &config = {});
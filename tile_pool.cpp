@@ -0,0 +1,111 @@
+#include "tile_pool.h"
+#include <algorithm>
+
+TilePool::TilePool(size_t workers)
+    : worker_total(workers ? workers : std::max(1u, std::thread::hardware_concurrency())),
+      shares(new Share[worker_total])
+{
+    for (size_t w = 1; w < worker_total; ++w)
+        threads.emplace_back(&TilePool::loop, this, w);
+}
+
+TilePool::~TilePool()
+{
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+bool TilePool::next_task(size_t worker, size_t &task)
+{
+    Share &own = shares[worker];
+    {
+        std::lock_guard<std::mutex> lck(own.mtx);
+        if (own.begin < own.end)
+        {
+            task = own.begin++;
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < worker_total; ++k)
+    {
+        Share &victim = shares[(worker + k) % worker_total];
+        size_t begin;
+        size_t end;
+        {
+            std::lock_guard<std::mutex> lck(victim.mtx);
+            const size_t left = victim.end - victim.begin;
+            if (left == 0)
+                continue;
+            end = victim.end;
+            begin = end - (left + 1) / 2;
+            victim.end = begin;
+        }
+        task = begin;
+        std::lock_guard<std::mutex> lck(own.mtx);
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+void TilePool::work(size_t worker)
+{
+    for (size_t task; next_task(worker, task);)
+        (*job)(task, worker);
+}
+
+void TilePool::loop(size_t worker)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            start_cv.wait(lck, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        work(worker);
+        std::lock_guard<std::mutex> lck(mtx);
+        if (--busy == 0)
+            done_cv.notify_one();
+    }
+}
+
+void TilePool::run(size_t count, const std::function<void(size_t task, size_t worker)> &f)
+{
+    if (count == 0)
+        return;
+    if (worker_total == 1 || count == 1)
+    {
+        for (size_t task = 0; task < count; ++task)
+            f(task, 0);
+        return;
+    }
+
+    for (size_t w = 0; w < worker_total; ++w)
+    {
+        std::lock_guard<std::mutex> lck(shares[w].mtx);
+        shares[w].begin = count * w / worker_total;
+        shares[w].end = count * (w + 1) / worker_total;
+    }
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        job = &f;
+        busy = worker_total - 1;
+        ++generation;
+    }
+    start_cv.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lck(mtx);
+    done_cv.wait(lck, [this] { return busy == 0; });
+    job = nullptr;
+}
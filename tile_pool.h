@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for data-parallel loops over tiles of work.
+// run(count, f) calls f(task, worker) once for every task in [0, count)
+// and returns when all of them are done; the calling thread takes part as
+// worker 0, so a pool of one worker runs everything inline.
+//
+// Each worker starts with an equal contiguous share of the tasks and takes
+// them from the front. A worker that runs out steals the back half of
+// another worker's share, so one crowded tile does not leave the others
+// idle. Which worker runs a task is not deterministic; callers that need
+// reproducible results keep per-task output and merge it in task order.
+class TilePool
+{
+private:
+    struct alignas(64) Share
+    {
+        std::mutex mtx;
+        size_t begin{0};
+        size_t end{0};
+    };
+
+    size_t worker_total;
+    std::unique_ptr<Share[]> shares;
+    std::vector<std::thread> threads;
+
+    std::mutex mtx;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation{0};
+    size_t busy{0};
+    bool stopping{false};
+    const std::function<void(size_t, size_t)> *job{nullptr};
+
+    bool next_task(size_t worker, size_t &task);
+    void work(size_t worker);
+    void loop(size_t worker);
+
+public:
+    // 0 picks std::thread::hardware_concurrency().
+    explicit TilePool(size_t workers = 0);
+    ~TilePool();
+
+    TilePool(const TilePool &) = delete;
+    TilePool &operator=(const TilePool &) = delete;
+
+    size_t workers() const { return worker_total; }
+    void run(size_t count, const std::function<void(size_t task, size_t worker)> &f);
+};
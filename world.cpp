@@ -0,0 +1,279 @@
+#include "world.h"
+#include <algorithm>
+
+World::World(const set_t &npcs)
+{
+    assign(npcs);
+}
+
+World::~World()
+{
+    clear();
+}
+
+npc_id World::add(const std::shared_ptr<NPC> &npc)
+{
+    if (!npc || npc->world)
+        return npos;
+
+    npc_id id;
+    if (!free_ids.empty())
+    {
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+    else
+    {
+        id = static_cast<npc_id>(slots.size());
+        slots.push_back(npos);
+        if (id == generations.size())
+            generations.push_back(0);
+    }
+
+    slots[id] = static_cast<uint32_t>(ids.size());
+    xs.push_back(npc->x);
+    ys.push_back(npc->y);
+    types.push_back(npc->type);
+    alive.push_back(npc->alive ? 1 : 0);
+    ids.push_back(id);
+    objects.push_back(npc);
+    if (npc->alive)
+        alive_types[npc->type].fetch_add(1, std::memory_order_relaxed);
+
+    npc->world = this;
+    npc->id = id;
+    if (npc->alive)
+        live = ids.size();
+
+    if (grid && npc->alive)
+        grid->insert(id, npc->x, npc->y);
+
+    return id;
+}
+
+void World::assign(const set_t &npcs)
+{
+    clear();
+    for (auto &npc : npcs)
+        add(npc);
+}
+
+void World::reserve(size_t count)
+{
+    xs.reserve(count);
+    ys.reserve(count);
+    types.reserve(count);
+    alive.reserve(count);
+    ids.reserve(count);
+    objects.reserve(count);
+    slots.reserve(count);
+    generations.reserve(count);
+}
+
+bool World::remove(npc_id id)
+{
+    if (!contains(id))
+        return false;
+
+    const size_t index = slots[id];
+    const size_t last = ids.size() - 1;
+
+    NPC &npc = *objects[index];
+    npc.x = xs[index];
+    npc.y = ys[index];
+    npc.alive = alive[index] != 0;
+    npc.world = nullptr;
+    if (alive[index])
+        alive_types[types[index]].fetch_sub(1, std::memory_order_relaxed);
+
+    if (grid)
+        grid->remove(id, xs[index], ys[index]);
+
+    if (index != last)
+    {
+        xs[index] = xs[last];
+        ys[index] = ys[last];
+        types[index] = types[last];
+        alive[index] = alive[last];
+        ids[index] = ids[last];
+        objects[index] = std::move(objects[last]);
+        slots[ids[index]] = static_cast<uint32_t>(index);
+    }
+
+    xs.pop_back();
+    ys.pop_back();
+    types.pop_back();
+    alive.pop_back();
+    ids.pop_back();
+    objects.pop_back();
+
+    slots[id] = npos;
+    ++generations[id];
+    free_ids.push_back(id);
+    live = std::min(live, ids.size());
+    return true;
+}
+
+void World::remove_dead()
+{
+    compact();
+    while (ids.size() > live)
+        remove(ids.back());
+}
+
+void World::compact()
+{
+    size_t front = 0;
+    size_t back = live;
+    while (true)
+    {
+        while (front < back && alive[front])
+            ++front;
+        while (front < back && !alive[back - 1])
+            --back;
+        if (back - front < 2)
+            break;
+        --back;
+        std::swap(xs[front], xs[back]);
+        std::swap(ys[front], ys[back]);
+        std::swap(types[front], types[back]);
+        std::swap(alive[front], alive[back]);
+        std::swap(ids[front], ids[back]);
+        std::swap(objects[front], objects[back]);
+        slots[ids[front]] = static_cast<uint32_t>(front);
+        slots[ids[back]] = static_cast<uint32_t>(back);
+        ++front;
+    }
+    live = front;
+}
+
+void World::clear()
+{
+    while (!ids.empty())
+        remove(ids.back());
+    // Generations outlive the ids, so handles taken before the clear stay stale.
+    slots.clear();
+    free_ids.clear();
+    if (grid)
+        grid->clear();
+}
+
+size_t World::alive_count() const
+{
+    size_t result = 0;
+    for (const auto &count : alive_types)
+        result += count.load(std::memory_order_relaxed);
+    return result;
+}
+
+bool World::contains(npc_id id) const
+{
+    return id < slots.size() && slots[id] != npos;
+}
+
+NPC *World::resolve(NpcHandle handle) const
+{
+    if (!contains(handle.id) || generations[handle.id] != handle.generation)
+        return nullptr;
+    return objects[slots[handle.id]].get();
+}
+
+std::pair<int, int> World::position(npc_id id) const
+{
+    const size_t index = slots[id];
+    return {xs[index], ys[index]};
+}
+
+bool World::is_alive_id(npc_id id) const
+{
+    return alive[slots[id]] != 0;
+}
+
+void World::move_at(size_t index, int shift_x, int shift_y, int max_x, int max_y)
+{
+    const int old_x = xs[index];
+    const int old_y = ys[index];
+    if ((old_x + shift_x >= 0) && (old_x + shift_x <= max_x))
+        xs[index] += shift_x;
+    if ((old_y + shift_y >= 0) && (old_y + shift_y <= max_y))
+        ys[index] += shift_y;
+    if (grid)
+        grid->relocate(ids[index], old_x, old_y, xs[index], ys[index]);
+    if (bus.has_subscribers<OnMove>())
+        bus.publish(OnMove{ids[index], old_x, old_y, xs[index], ys[index]});
+}
+
+void World::move(npc_id id, int shift_x, int shift_y, int max_x, int max_y)
+{
+    move_at(slots[id], shift_x, shift_y, max_x, max_y);
+}
+
+void World::begin_moves()
+{
+    next_xs.resize(xs.size());
+    next_ys.resize(ys.size());
+    std::copy(xs.begin(), xs.begin() + live, next_xs.begin());
+    std::copy(ys.begin(), ys.begin() + live, next_ys.begin());
+}
+
+void World::stage_move(size_t index, int shift_x, int shift_y, int max_x, int max_y)
+{
+    const int old_x = xs[index];
+    const int old_y = ys[index];
+    if ((old_x + shift_x >= 0) && (old_x + shift_x <= max_x))
+        next_xs[index] = old_x + shift_x;
+    if ((old_y + shift_y >= 0) && (old_y + shift_y <= max_y))
+        next_ys[index] = old_y + shift_y;
+}
+
+void World::commit_moves()
+{
+    const bool notify = bus.has_subscribers<OnMove>();
+    for (size_t i = 0; i < live; ++i)
+    {
+        if (xs[i] == next_xs[i] && ys[i] == next_ys[i])
+            continue;
+        if (grid)
+            grid->relocate(ids[i], xs[i], ys[i], next_xs[i], next_ys[i]);
+        if (notify)
+            bus.publish(OnMove{ids[i], xs[i], ys[i], next_xs[i], next_ys[i]});
+        xs[i] = next_xs[i];
+        ys[i] = next_ys[i];
+    }
+}
+
+void World::kill(npc_id id)
+{
+    const size_t index = slots[id];
+    if (!alive[index])
+        return;
+    alive[index] = 0;
+    alive_types[types[index]].fetch_sub(1, std::memory_order_relaxed);
+    if (bus.has_subscribers<OnDeath>())
+        bus.publish(OnDeath{*objects[index]});
+}
+
+void World::unindex(npc_id id)
+{
+    const size_t index = slots[id];
+    if (grid && !alive[index])
+        grid->remove(id, xs[index], ys[index]);
+}
+
+void World::build_grid(int cell_size)
+{
+    grid = std::make_unique<SpatialGrid>(cell_size);
+    for (size_t i = 0; i < ids.size(); ++i)
+        if (alive[i])
+            grid->insert(ids[i], xs[i], ys[i]);
+}
+
+void World::drop_grid()
+{
+    grid.reset();
+}
+
+set_t World::view() const
+{
+    return set_t(objects.begin(), objects.end());
+}
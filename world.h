@@ -0,0 +1,143 @@
+#pragma once
+
+#include "npc.h"
+#include "spatial_grid.h"
+#include "event_bus.h"
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+using npc_id = uint32_t;
+
+// Weak reference to an NPC of a World: its id plus the generation the id
+// had when the handle was taken. Removing an NPC bumps its id's
+// generation, so a handle kept past the removal no longer resolves even
+// after the id is reused.
+struct NpcHandle
+{
+    npc_id id;
+    uint32_t generation;
+};
+
+// Structure-of-arrays NPC store. Positions, types and alive flags live in
+// parallel dense arrays so the simulation loops stream them linearly.
+// Every NPC gets a stable id; the dense index of an NPC may change when
+// another one is removed (swap-remove), its id never does.
+//
+// NPC objects added to a World are bound to it: their position(),
+// is_alive(), move() and must_die() read and write the arrays, so the
+// factory, save/load and printing code keep working through them.
+//
+// Per-tick movement is double buffered. begin_moves() copies the current
+// positions into a back buffer, stage_move() reads the front buffer and
+// writes only its own slot of the back one, and commit_moves() publishes
+// the whole step at once (grid update, OnMove events, copy back). Until
+// the commit every reader sees the previous tick, and stage_move() calls
+// for different indices may run on different threads without locking.
+//
+// Every NPC at index live_end() or above is dead. compact() swaps the
+// NPCs that died below it to the tail and moves live_end() down to the
+// alive count, so loops that stop at live_end() cost only what is alive.
+// Moves, the back buffer and compaction only touch the live range.
+class World
+{
+public:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+private:
+    std::vector<int> xs;
+    std::vector<int> ys;
+    std::vector<int> next_xs;
+    std::vector<int> next_ys;
+    std::vector<NpcType> types;
+    std::vector<uint8_t> alive;
+    std::vector<npc_id> ids;
+    std::vector<std::shared_ptr<NPC>> objects;
+
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> generations;
+    std::vector<npc_id> free_ids;
+    size_t live{0};
+    // Alive NPCs per type, kept up to date by add/remove/kill. Fight
+    // workers kill concurrently, hence atomic.
+    std::atomic<size_t> alive_types[NpcTypeCount]{};
+
+    std::unique_ptr<SpatialGrid> grid;
+    EventBus bus;
+
+public:
+    World() = default;
+    explicit World(const set_t &npcs);
+    ~World();
+
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
+
+    npc_id add(const std::shared_ptr<NPC> &npc);
+    void assign(const set_t &npcs);
+    void reserve(size_t count);
+    bool remove(npc_id id);
+    void remove_dead();
+    void clear();
+    // Must not run while staged moves are pending or fights are resolved.
+    void compact();
+
+    size_t size() const { return ids.size(); }
+    size_t live_end() const { return live; }
+    bool empty() const { return ids.empty(); }
+    size_t alive_count() const;
+    size_t alive_count(NpcType type) const { return alive_types[type].load(std::memory_order_relaxed); }
+
+    bool contains(npc_id id) const;
+    size_t index_of(npc_id id) const { return slots[id]; }
+    npc_id id_at(size_t index) const { return ids[index]; }
+    NpcHandle handle_at(size_t index) const { return {ids[index], generations[ids[index]]}; }
+    // The NPC a handle refers to, or nullptr if it was removed since.
+    NPC *resolve(NpcHandle handle) const;
+
+    int x(size_t index) const { return xs[index]; }
+    int y(size_t index) const { return ys[index]; }
+    NpcType type(size_t index) const { return types[index]; }
+    bool is_alive(size_t index) const { return alive[index] != 0; }
+    const std::shared_ptr<NPC> &object(size_t index) const { return objects[index]; }
+
+    const int *x_data() const { return xs.data(); }
+    const int *y_data() const { return ys.data(); }
+    const NpcType *type_data() const { return types.data(); }
+    const uint8_t *alive_data() const { return alive.data(); }
+
+    std::pair<int, int> position(npc_id id) const;
+    bool is_alive_id(npc_id id) const;
+    void move_at(size_t index, int shift_x, int shift_y, int max_x, int max_y);
+    void move(npc_id id, int shift_x, int shift_y, int max_x, int max_y);
+
+    void begin_moves();
+    void stage_move(size_t index, int shift_x, int shift_y, int max_x, int max_y);
+    void commit_moves();
+    void kill(npc_id id);
+    // Drops a dead NPC from the spatial grid so later queries skip it.
+    void unindex(npc_id id);
+
+    void build_grid(int cell_size);
+    void drop_grid();
+    const SpatialGrid *spatial() const { return grid.get(); }
+
+    template <typename F>
+    void for_each_neighbour(size_t index, int radius, F &&f) const;
+
+    EventBus &events() { return bus; }
+    const EventBus &events() const { return bus; }
+
+    set_t view() const;
+};
+
+template <typename F>
+void World::for_each_neighbour(size_t index, int radius, F &&f) const
+{
+    if (!grid)
+        return;
+    grid->for_each_neighbour(xs[index], ys[index], radius, [this, &f](uint32_t key)
+    {
+        f(slots[key]);
+    });
+}